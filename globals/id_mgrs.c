@@ -15,6 +15,7 @@ static bool id_mgr_valid(enum GIdMgr id_manager)
         case ID_MGR_CTS:
         case ID_MGR_SYS:
         case ID_MGR_ARCTS:
+        case ID_MGR_QUERIES:
                 return true;
         case ID_MGR_ITEM_COUNT:
                 return false;
@@ -33,9 +34,10 @@ void init_id_managers(void)
         ASSERT(!g_id_mgrs_initialized, "Id managers already initialized.");
 
         // For each type of manager in "enum GIdMgr", initialize
-        // corresponding "struct IdMgr".
+        // corresponding "struct IdMgr". Component type IDs have a width
+        // of their own (see "PCECS_CT_ID_BITS").
         for (int i = 0; i < ID_MGR_ITEM_COUNT; i++) {
-                g_id_mgrs[i] = create_id_manager();
+                g_id_mgrs[i] = create_id_manager(i == ID_MGR_CTS ? PCECS_MAX_CT_ID : PCECS_MAX_ID);
         }
         g_id_mgrs_initialized = true;
 }
@@ -53,6 +55,8 @@ void init_id_managers(void)
                         return "system";
                 case ID_MGR_ARCTS:
                         return "archetype";
+                case ID_MGR_QUERIES:
+                        return "query";
                 case ID_MGR_ITEM_COUNT:
                         break;
                 }
@@ -85,6 +89,14 @@ pcecs_id_t generate_id_of_type(enum GIdMgr mgr)
         return id;
 }
 
+void generate_ids_of_type(enum GIdMgr mgr, pcecs_id_t * ids, size_t count)
+{
+        LOG_DEBUG("Generating %d ids from %s id manager ...\n", (int) count, id_mgr_as_str(mgr));
+
+        struct IdMgr * id_manager_ptr = get_id_manager(mgr);
+        generate_ids(id_manager_ptr, ids, count);
+}
+
 void destroy_id_of_type(enum GIdMgr mgr, pcecs_id_t id)
 {
         LOG_DEBUG("Destroying " PCECS_ID_FS " from %s id manager ...\n",
@@ -97,3 +109,22 @@ void destroy_id_of_type(enum GIdMgr mgr, pcecs_id_t id)
 
         destroy_id(mgr_ptr, id);
 }
+
+void destroy_ids_of_type(enum GIdMgr mgr, const pcecs_id_t * ids, size_t count)
+{
+        LOG_DEBUG("Destroying %d ids from %s id manager ...\n", (int) count, id_mgr_as_str(mgr));
+
+        struct IdMgr * mgr_ptr = get_id_manager(mgr);
+        destroy_ids(mgr_ptr, ids, count);
+}
+
+struct PcecsMemUsage id_managers_mem_usage(void)
+{
+        struct PcecsMemUsage usage = {0};
+        for (int i = 0; i < ID_MGR_ITEM_COUNT; ++i) {
+                struct PcecsMemUsage pool_usage = id_pool_mem_usage(&get_id_manager(i)->unused_ids);
+                usage.used += pool_usage.used;
+                usage.reserved += pool_usage.reserved;
+        }
+        return usage;
+}
@@ -5,13 +5,16 @@
 #ifndef ID_MGRS_H
 #define ID_MGRS_H
 
+#include <stddef.h>
 #include "../ids/id.h"
+#include "../interface/mem_stats.h"
 
 enum GIdMgr {
         ID_MGR_ENTITIES,
         ID_MGR_CTS,
         ID_MGR_SYS,
         ID_MGR_ARCTS,
+        ID_MGR_QUERIES,
         ID_MGR_ITEM_COUNT
 };
 
@@ -24,7 +27,17 @@ void init_id_managers(void);
 // they aren't supposed to be compared anyway.
 pcecs_id_t generate_id_of_type(enum GIdMgr mgr);
 
+// Generates "count" IDs at once, writing them to "ids".
+void generate_ids_of_type(enum GIdMgr mgr, pcecs_id_t * ids, size_t count);
+
 // Marks an ID for later use.
 void destroy_id_of_type(enum GIdMgr mgr, pcecs_id_t id);
 
+// Marks the "count" IDs of "ids" for later use.
+void destroy_ids_of_type(enum GIdMgr mgr, const pcecs_id_t * ids, size_t count);
+
+// The memory allocated by every ID manager, for the IDs waiting to be
+// reused.
+struct PcecsMemUsage id_managers_mem_usage(void);
+
 #endif
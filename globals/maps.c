@@ -6,6 +6,7 @@
 #include "../structs/ct_data.h"
 #include "../structs/sys_data.h"
 #include "../structs/arct_data.h"
+#include "../structs/query.h"
 
 void init_maps(void)
 {
@@ -15,12 +16,14 @@ void init_maps(void)
 
         ASSERT(!s_maps_initialized, "Maps already initialized.");
 
-        // "CtData"s and "ArctData"s cannot be destroyed, so destructors
+        // "CtData"s and "QueryData"s cannot be destroyed, so destructors
         // are simply not provided.
-        g_entity_map = create_map(sizeof(struct EntityData), destroy_entity_data_void);
+        g_entity_map = create_paged_map(sizeof(struct EntityData), destroy_entity_data_void,
+                ENTITY_MAP_PAGE_SIZE);
         g_ct_map = create_map(sizeof(struct CtData), NULL);
         g_sys_map = create_map(sizeof(struct SysData), destroy_sys_data_void);
-        g_arct_map = create_map(sizeof(struct ArctData), NULL);
+        g_arct_map = create_map(sizeof(struct ArctData), destroy_arct_data_void);
+        g_query_map = create_map(sizeof(struct QueryData), NULL);
 
         s_maps_initialized = true;
 }
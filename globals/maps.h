@@ -9,6 +9,7 @@ struct Map g_entity_map;
 struct Map g_ct_map;
 struct Map g_sys_map;
 struct Map g_arct_map;
+struct Map g_query_map;
 
 // Initialize all global maps. Must only be done once.
 void init_maps(void);
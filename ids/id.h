@@ -3,12 +3,51 @@
 #ifndef PCECS_ID_H
 #define PCECS_ID_H
 
-#define PCECS_ID_FS "id %d"
-#define PCECS_ID_FA(id) (int) id
+#include "../tools/uint_bits.h"
+
+// The width of every kind of ID (entities, component types, systems,
+// archetypes and queries), in bits. 16 bits makes maps, pools, handles
+// and tables smaller, but allows at most 65535 of each kind at once,
+// while 64 bits allows practically any number.
+// "#define" it before including pcecs, or pass it to the compiler, to
+// choose another width. Every file must be compiled with the same one.
+// Component type IDs may be narrower (see "PCECS_CT_ID_BITS").
+#ifndef PCECS_ID_BITS
+#define PCECS_ID_BITS 32
+#endif
+
+typedef UINT_OF_BITS(PCECS_ID_BITS) pcecs_id_t;
+
+#define PCECS_ID_FS "id %" PRIU_OF_BITS(PCECS_ID_BITS)
+#define PCECS_ID_FA(id) (pcecs_id_t) (id)
 
 // Must not be changed since code might rely on this value.
 #define PCECS_INVALID_ID 0
 
-typedef unsigned int pcecs_id_t;
+// The greatest ID that can be generated.
+#define PCECS_MAX_ID MAX_OF_UINT(pcecs_id_t)
+
+// The width of component type IDs, in bits, which may be smaller than
+// "PCECS_ID_BITS" so that few component types don't force few entities.
+// It makes "struct Ct", and so the commands of command buffers, smaller.
+// Maps keyed by component types (such as the columns of archetypes and
+// their edges) still store their keys as "pcecs_id_t", since maps are
+// shared by every kind of ID, but what they allocate per ID is indexed
+// by the value of the ID rather than its width.
+#ifndef PCECS_CT_ID_BITS
+#define PCECS_CT_ID_BITS PCECS_ID_BITS
+#endif
+
+#if PCECS_CT_ID_BITS > PCECS_ID_BITS
+#error "PCECS_CT_ID_BITS" cannot be greater than "PCECS_ID_BITS".
+#endif
+
+typedef UINT_OF_BITS(PCECS_CT_ID_BITS) ct_id_t;
+
+#define CT_ID_FS "id %" PRIU_OF_BITS(PCECS_CT_ID_BITS)
+#define CT_ID_FA(id) (ct_id_t) (id)
+
+// The greatest component type ID that can be generated.
+#define PCECS_MAX_CT_ID MAX_OF_UINT(ct_id_t)
 
 #endif
@@ -4,12 +4,13 @@
 #include "../tools/debug.h"
 #include "../tools/log.h"
 
-struct IdMgr create_id_manager(void)
+struct IdMgr create_id_manager(pcecs_id_t id_limit)
 {
         LOG_DEBUG("Creating id manager ...\n");
 
         struct IdMgr mgr = {
                 .max_id = 0,
+                .id_limit = id_limit,
                 .unused_ids = create_id_pool()
         };
         return mgr;
@@ -58,12 +59,35 @@ pcecs_id_t generate_id(struct IdMgr * mgr)
         // Since max_id is initialized to 0, the first ID
         // generated will be 1.
         STATIC_ASSERT(PCECS_INVALID_ID == 0);
+        ASSERT(mgr->max_id != mgr->id_limit,
+                "Out of IDs; consider a greater \"PCECS_ID_BITS\" or \"PCECS_CT_ID_BITS\".");
         pcecs_id_t id = ++mgr->max_id;
 
         LOG_DEBUG("Generated " PCECS_ID_FS ".\n", PCECS_ID_FA(id));
         return id;
 }
 
+void generate_ids(struct IdMgr * mgr, pcecs_id_t * ids, size_t count)
+{
+        LOG_DEBUG("Generating %d ids ...\n", (int) count);
+
+        size_t id_idx = 0;
+        while (id_idx < count && mgr->unused_ids.len > 0) {
+                ids[id_idx++] = steal_from_id_pool(&mgr->unused_ids);
+        }
+
+        // Same as in "generate_id", the first ID taken from "max_id"
+        // is the one after it.
+        STATIC_ASSERT(PCECS_INVALID_ID == 0);
+        ASSERT(count - id_idx <= (size_t) (mgr->id_limit - mgr->max_id),
+                "Out of IDs; consider a greater \"PCECS_ID_BITS\" or \"PCECS_CT_ID_BITS\".");
+        pcecs_id_t first_new_id = mgr->max_id + 1;
+        for (size_t i = id_idx; i < count; ++i) {
+                ids[i] = first_new_id + (pcecs_id_t) (i - id_idx);
+        }
+        mgr->max_id += (pcecs_id_t) (count - id_idx);
+}
+
 void destroy_id(struct IdMgr * mgr, pcecs_id_t id)
 {
         LOG_DEBUG("Destroying " PCECS_ID_FS " ...\n", PCECS_ID_FA(id));
@@ -71,3 +95,13 @@ void destroy_id(struct IdMgr * mgr, pcecs_id_t id)
 
         add_to_id_pool(&mgr->unused_ids, id);
 }
+
+void destroy_ids(struct IdMgr * mgr, const pcecs_id_t * ids, size_t count)
+{
+        LOG_DEBUG("Destroying %d ids ...\n", (int) count);
+
+        for (size_t i = 0; i < count; ++i) {
+                ASSERT(id_in_use(mgr, ids[i]), "Id not in use.");
+                add_to_id_pool(&mgr->unused_ids, ids[i]);
+        }
+}
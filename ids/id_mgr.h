@@ -21,11 +21,14 @@
 struct IdMgr
 {
         pcecs_id_t max_id;
+        // The greatest ID the manager may generate.
+        pcecs_id_t id_limit;
         struct IdPool unused_ids;
 };
 
-// Create a "struct IdMgr" with no IDs.
-struct IdMgr create_id_manager(void);
+// Create a "struct IdMgr" with no IDs, which generates IDs up to
+// "id_limit" (at most "PCECS_MAX_ID").
+struct IdMgr create_id_manager(pcecs_id_t id_limit);
 
 // Destroy a "struct IdMgr". Nothing happens to IDs
 // generated by it.
@@ -45,9 +48,18 @@ bool id_in_use(const struct IdMgr * mgr, pcecs_id_t id);
 // or IDs previously destroyed by "mgr".
 pcecs_id_t generate_id(struct IdMgr * mgr);
 
+// Generates "count" IDs the same way as "generate_id", writing them
+// to "ids". Destroyed IDs are reused first, and the rest are taken
+// from "max_id" all at once.
+void generate_ids(struct IdMgr * mgr, pcecs_id_t * ids, size_t count);
+
 // Marks an ID as unused by "mgr". "generate_id"
 // using the same id manager might regenerate the
 // destroyed ID. Assumes "id" is used by "mgr".
 void destroy_id(struct IdMgr * mgr, pcecs_id_t id);
 
+// Same as "destroy_id" for each of the "count" IDs
+// of "ids".
+void destroy_ids(struct IdMgr * mgr, const pcecs_id_t * ids, size_t count);
+
 #endif
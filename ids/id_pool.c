@@ -1,5 +1,7 @@
 #include "id_pool.h"
 
+#define MEM_TAG MEM_TAG_ID_POOL
+
 #define ID_POOL_CAPACITY_MUL (2)
 
 struct IdPool create_id_pool(void)
@@ -12,8 +14,8 @@ struct IdPool create_id_pool(void)
         // multiplied over and over to grow.
         pool.capacity = 1;
         pool.contents = ALLOC(pcecs_id_t, pool.capacity);
-        pool.id_in_pool = ALLOC(byte_t, 0);
-        pool.max_id = 0;
+        pool.id_to_idx = NULL;
+        pool.id_to_idx_size = 0;
         return pool;
 }
 
@@ -55,7 +57,7 @@ void destroy_id_pool(struct IdPool * pool)
 {
         validate_id_pool(pool);
         FREE(pool->contents);
-        FREE(pool->id_in_pool);
+        FREE(pool->id_to_idx);
 }
 
 static void resize_id_pool(struct IdPool * pool, size_t capacity)
@@ -107,38 +109,23 @@ static void set_id_pool_len(struct IdPool * pool, size_t len)
         }
 }
 
-// TODO: comment all below
-
 bool id_pool_contains(const struct IdPool * pool, pcecs_id_t value)
 {
-        for (pcecs_id_t i = 0; i < pool->len; ++i) {
-                if (pool->contents[i] == value) {
-                        return true;
-                }
+        if (value >= pool->id_to_idx_size) {
+                return false;
         }
-        return false;
-}
 
-static byte_t idx_of_byte(pcecs_id_t id)
-{
-        return id / CHAR_BIT;
-}
-
-static byte_t idx_of_bit_within_byte(pcecs_id_t id)
-{
-        return id % CHAR_BIT;
+        pcecs_id_t idx = pool->id_to_idx[value];
+        return idx < pool->len && pool->contents[idx] == value;
 }
 
 static void remove_idx_from_id_pool(struct IdPool * pool, size_t idx)
 {
-        pcecs_id_t removed_id = pool->contents[idx];
-        pool->contents[idx] = pool->contents[pool->len - 1];
+        pcecs_id_t moved_id = pool->contents[pool->len - 1];
+        pool->contents[idx] = moved_id;
+        pool->id_to_idx[moved_id] = (pcecs_id_t) idx;
 
         set_id_pool_len(pool, pool->len - 1);
-
-        byte_t * byte_with_value = &pool->id_in_pool[idx_of_byte(removed_id)];
-        byte_t bit_with_value = 1 << idx_of_bit_within_byte(removed_id);
-        *byte_with_value &= ~bit_with_value;
 }
 
 pcecs_id_t steal_from_id_pool(struct IdPool * pool)
@@ -151,66 +138,59 @@ pcecs_id_t steal_from_id_pool(struct IdPool * pool)
         return removed_id;
 }
 
-static void set_max_id(struct IdPool * id_pool, pcecs_id_t new_max_id)
+// Makes room for the index of "id", growing geometrically so that adding
+// ever greater IDs doesn't reallocate every time.
+static void fit_id_in_id_pool(struct IdPool * id_pool, pcecs_id_t id)
 {
-        REALLOC(&id_pool->id_in_pool, byte_t, idx_of_byte(new_max_id) + 1);
+        if (id < id_pool->id_to_idx_size) {
+                return;
+        }
 
-        if (new_max_id > id_pool->max_id) {
-                for (int i = idx_of_byte(id_pool->max_id) + 1; i <= idx_of_byte(new_max_id); ++i) {
-                        id_pool->id_in_pool[i] = 0;
-                }
+        size_t size = id_pool->id_to_idx_size * ID_POOL_CAPACITY_MUL;
+        if (size <= id) {
+                size = (size_t) id + 1;
         }
 
-        id_pool->max_id = new_max_id;
+        REALLOC(&id_pool->id_to_idx, pcecs_id_t, size);
+        // Any index is valid for IDs that aren't in the pool, but
+        // leaving them uninitialized would make them read garbage.
+        for (size_t i = id_pool->id_to_idx_size; i < size; ++i) {
+                id_pool->id_to_idx[i] = 0;
+        }
+        id_pool->id_to_idx_size = size;
 }
 
 void add_to_id_pool(struct IdPool * id_pool, pcecs_id_t value)
 {
         ASSERT(!id_pool_contains(id_pool, value), "Id already in pool.");
 
+        fit_id_in_id_pool(id_pool, value);
+
         // Add a new element to the pool and set its value.
         set_id_pool_len(id_pool, id_pool->len + 1);
         id_pool->contents[id_pool->len - 1] = value;
-
-        if (value > id_pool->max_id) {
-                set_max_id(id_pool, value);
-        }
-
-        byte_t * byte_with_value = &id_pool->id_in_pool[idx_of_byte(value)];
-        byte_t bit_with_value = 1 << idx_of_bit_within_byte(value);
-        *byte_with_value |= bit_with_value;
+        id_pool->id_to_idx[value] = (pcecs_id_t) (id_pool->len - 1);
 }
 
 // Replace "value" in "id_pool" with the last ID and remove the last
 // ID.
 void remove_from_id_pool(struct IdPool * id_pool, pcecs_id_t value)
 {
-        bool found = false;
-        // Unused if "ASSERTIONS" isn't defined.
-        (void) found;
-
-        size_t idx_of_id = 0;
-
-        for (size_t i = 0; i < id_pool->len; ++i) {
-                if (id_pool->contents[i] == value) {
-                        idx_of_id = i;
-                        found = true;
-                        break;
-                }
-        }
+        ASSERT(id_pool_contains(id_pool, value), "Id not in pool.");
 
-        ASSERT(found, "Id not in pool.");
-
-        remove_idx_from_id_pool(id_pool, idx_of_id);
+        remove_idx_from_id_pool(id_pool, id_pool->id_to_idx[value]);
 }
 
 bool id_in_pool(const struct IdPool * id_pool, pcecs_id_t id)
 {
-        if (id > id_pool->max_id) {
-                return false;
-        }
+        return id_pool_contains(id_pool, id);
+}
 
-        byte_t * byte_with_id = &id_pool->id_in_pool[idx_of_byte(id)];
-        byte_t bit_with_id = 1 << idx_of_bit_within_byte(id);
-        return *byte_with_id & bit_with_id;
+struct PcecsMemUsage id_pool_mem_usage(const struct IdPool * id_pool)
+{
+        size_t indices_size = id_pool->id_to_idx_size * sizeof(pcecs_id_t);
+        return (struct PcecsMemUsage) {
+                .used = id_pool->len * sizeof(pcecs_id_t) + indices_size,
+                .reserved = id_pool->capacity * sizeof(pcecs_id_t) + indices_size
+        };
 }
@@ -6,6 +6,7 @@
 #include "id.h"
 #include "../tools/mem_tools.h"
 #include "../tools/byte.h"
+#include "../interface/mem_stats.h"
 
 struct IdPool
 {
@@ -19,9 +20,13 @@ struct IdPool
         // give you all the IDs in the pool.
         // Adding or removing IDs while this is going on is illegal.
         pcecs_id_t * contents;
-        // One bit for each ID, being on iff the ID is in the pool.
-        byte_t * id_in_pool;
-        pcecs_id_t max_id;
+        // The index in "contents" of each ID up to "id_to_idx_size" - 1.
+        // An ID is in the pool iff its index is less than "len" and
+        // "contents" has the ID at that index, so indices of IDs that
+        // aren't in the pool may be anything. Grows geometrically to fit
+        // the greatest ID ever added.
+        pcecs_id_t * id_to_idx;
+        size_t id_to_idx_size;
 };
 
 // Create an "IdPool", initialized with no IDs.
@@ -31,6 +36,7 @@ struct IdPool create_id_pool(void);
 void destroy_id_pool(struct IdPool * pool);
 
 // Returns "true" if "pool" contains "value".
+// Time complexity O(1).
 bool id_pool_contains(const struct IdPool * pool, pcecs_id_t value);
 
 // Remove an arbitrary ID from a pool of IDs and return its value.
@@ -42,12 +48,15 @@ pcecs_id_t steal_from_id_pool(struct IdPool * pool);
 // pointers to IDs within the pool.
 void add_to_id_pool(struct IdPool * id_pool, pcecs_id_t value);
 
-// Remove "value" from "id_pool", assuming it's there.
-// It's not very fast, with a time complexity of O(n).
+// Remove "value" from "id_pool", assuming it's there. The last ID of
+// "contents" takes its place.
+// Time complexity O(1).
 void remove_from_id_pool(struct IdPool * id_pool, pcecs_id_t value);
 
-// Returns "true" iff "id" is in "id_pool".
-// Time complexity O(1).
+// Same as "id_pool_contains".
 bool id_in_pool(const struct IdPool * id_pool, pcecs_id_t id);
 
+// The memory allocated by "id_pool". The indices of IDs count as used.
+struct PcecsMemUsage id_pool_mem_usage(const struct IdPool * id_pool);
+
 #endif
@@ -4,6 +4,7 @@
 #define PCECS_INCLUDES_H
 
 #include "interface/init.h"
+#include "interface/allocator.h"
 
 #include "interface/entity.h"
 #include "interface/ct.h"
@@ -12,5 +13,9 @@
 
 #include "interface/ct_set.h"
 #include "interface/cgroup.h"
+#include "interface/cbatch.h"
+#include "interface/cmd_buf.h"
+#include "interface/storage.h"
+#include "interface/mem_stats.h"
 
 #endif
@@ -0,0 +1,56 @@
+// Lets programs using pcecs provide the memory it allocates, by passing
+// an allocator to "init_pcecs_with_allocator".
+
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stddef.h>
+
+// The alignment of memory that isn't explicitly aligned. Memory returned
+// by "malloc" always has at least this alignment.
+#define DEFAULT_ALIGNMENT (_Alignof(max_align_t))
+
+// The part of pcecs an allocation is made by, so that allocators can
+// treat them differently (e.g. put short-lived command buffers in an
+// arena and columns in a thread cache).
+enum MemTag {
+        // Maps from IDs to entities, component types, archetypes, systems
+        // and queries, and the sets of IDs in each.
+        MEM_TAG_MAP,
+        MEM_TAG_ID_POOL,
+        MEM_TAG_CT_SET,
+        // Component storage.
+        MEM_TAG_COLUMN,
+        MEM_TAG_CTABLE,
+        // Archetype bookkeeping other than component storage.
+        MEM_TAG_ARCT,
+        // Short-lived lists used while changing many entities at once.
+        MEM_TAG_ENTITY,
+        // Deferred commands, which only live until they're applied.
+        MEM_TAG_CMD_BUF,
+        // Threads and the schedule of systems running on them.
+        MEM_TAG_SCHEDULE,
+        MEM_TAG_THREAD_POOL,
+        MEM_TAG_COUNT
+};
+
+// The functions pcecs allocates and frees memory with. "owner" is
+// passed to every function, and may be used for any purpose.
+// All three functions may be called from any thread running systems.
+struct Allocator {
+        // Allocates "size" bytes at an address that's a multiple of
+        // "alignment", a power of two that's at least
+        // "DEFAULT_ALIGNMENT". Must not fail, except by returning NULL
+        // when "size" is 0.
+        void * (* alloc)(void * owner, size_t size, size_t alignment, enum MemTag tag);
+        // Resizes "ptr", which is NULL or allocated with
+        // "DEFAULT_ALIGNMENT", to "size" bytes like "realloc", keeping
+        // "DEFAULT_ALIGNMENT". "tag" is the one "ptr" was allocated with.
+        void * (* realloc)(void * owner, void * ptr, size_t size, enum MemTag tag);
+        // Frees "ptr", which is NULL or allocated with "alignment" and
+        // "tag".
+        void (* free)(void * owner, void * ptr, size_t alignment, enum MemTag tag);
+        void * owner;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "cbatch.h"
+#include "../tools/log.h"
+#include "../tools/debug.h"
+#include "../globals/maps.h"
+#include "../structs/sys_data.h"
+
+#ifdef ASSERTIONS
+static bool ct_written_by_sys(struct Sys sys, struct Ct ct)
+{
+        const struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        return ct_in_set(&sys_data->writes, ct);
+}
+#endif
+
+const void * read_batch_column(const struct CBatch * batch, struct Ct ct)
+{
+        // Batches rarely have more than a handful of columns, and this
+        // is called once per batch rather than once per entity, so a
+        // linear search is more than fast enough.
+        for (size_t i = 0; i < batch->column_count; ++i) {
+                if (cts_equal(batch->cts[i], ct)) {
+                        return batch->columns[i];
+                }
+        }
+
+        ASSERT_OR_HANDLE(false, NULL, "No " CT_FS " in " CBATCH_FS ".",
+                CT_FA(ct), CBATCH_FA(*batch));
+        return NULL;
+}
+
+void * get_batch_column(const struct CBatch * batch, struct Ct ct)
+{
+        ASSERT(ct_written_by_sys(batch->sys, ct), CT_FS " is not written by " SYS_FS ". "
+                "Use \"read_batch_column\" to read it.", CT_FA(ct), SYS_FA(batch->sys));
+
+        // Writing the column is fine, since the system declared it.
+        return (void *) read_batch_column(batch, ct);
+}
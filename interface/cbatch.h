@@ -0,0 +1,49 @@
+// The structure used in batch system functions ("sys_batch_func_t").
+// A component group ("struct CGroup") is a single entity seen through
+// a system, while a component batch is every entity of an archetype
+// seen through a system at once.
+// Batches hold one contiguous buffer ("column") of components for
+// each component type required by the system. The components of
+// "entities[i]" are found at index "i" of every column, so a batch
+// function can loop over plain arrays instead of looking up each
+// component of each entity.
+
+#ifndef CBATCH_H
+#define CBATCH_H
+
+#include <stddef.h>
+#include "entity.h"
+#include "sys.h"
+
+#define CBATCH_FS "component batch (" SYS_FS ", %d rows)"
+#define CBATCH_FA(cbatch) SYS_FA((cbatch).sys), (int) (cbatch).row_count
+
+struct CBatch {
+        struct Sys sys;
+        // The number of entities in the batch, and therefore also the
+        // number of components in each column.
+        size_t row_count;
+        // The entity owning index "i" of every column is "entities[i]".
+        const struct Entity * entities;
+        // The component types required by "sys" and their columns;
+        // "columns[i]" holds the components of type "cts[i]".
+        size_t column_count;
+        const struct Ct * cts;
+        void * const * columns;
+};
+
+// Like "cgroup.h", the creation of component batches is left to the
+// implementation.
+
+// Returns the column of "ct" in "batch". The column is an array of
+// "batch->row_count" components of type "ct", so it's meant to be
+// cast to a pointer to the actual component type and indexed by row.
+// Asserts that the system of "batch" requires "ct", and in debug
+// builds that it writes "ct" (see "create_sys_with_access").
+void * get_batch_column(const struct CBatch * batch, struct Ct ct);
+
+// Same as "get_batch_column", except the column is only read, so "ct"
+// may be any component type required by the system of "batch".
+const void * read_batch_column(const struct CBatch * batch, struct Ct ct);
+
+#endif
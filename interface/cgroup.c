@@ -11,7 +11,28 @@ static bool ct_in_sys(struct Sys sys, struct Ct ct)
         return ct_in_set(&sys_data->requirements, ct);
 }
 
+#ifdef ASSERTIONS
+static bool ct_written_by_sys(struct Sys sys, struct Ct ct)
+{
+        const struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        return ct_in_set(&sys_data->writes, ct);
+}
+#endif
+
 void * get_component(struct CGroup * cgroup, struct Ct ct)
+{
+        ASSERT_OR_HANDLE(ct_in_sys(cgroup->sys, ct), NULL, "No " CT_FS " in " SYS_FS ".",
+                CT_FA(ct), SYS_FA(cgroup->sys));
+
+        // Systems running alongside "cgroup->sys" may be reading the
+        // component if it's not declared as written.
+        ASSERT(ct_written_by_sys(cgroup->sys, ct), CT_FS " is not written by " SYS_FS ". "
+                "Use \"read_component\" to read it.", CT_FA(ct), SYS_FA(cgroup->sys));
+
+        return get_component_from_entity(cgroup->entity, ct);
+}
+
+const void * read_component(const struct CGroup * cgroup, struct Ct ct)
 {
         ASSERT_OR_HANDLE(ct_in_sys(cgroup->sys, ct), NULL, "No " CT_FS " in " SYS_FS ".",
                 CT_FA(ct), SYS_FA(cgroup->sys));
@@ -28,6 +28,11 @@ struct CGroup {
 
 // Asserts that the system of "cgroup" requires its entities to have "ct" before returning the
 // component. Otherwise, it's equivalent to "get_component_from_entity(cgroup->entity)".
+// Debug builds also assert that the system writes "ct" (see "create_sys_with_access").
 void * get_component(struct CGroup * cgroup, struct Ct ct);
 
+// Same as "get_component", except the component is only read, so "ct" may be any
+// component type required by the system of "cgroup".
+const void * read_component(const struct CGroup * cgroup, struct Ct ct);
+
 #endif
@@ -0,0 +1,534 @@
+#include "cmd_buf.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+#include "../tools/byte.h"
+#include "../globals/maps.h"
+#include "../globals/id_mgrs.h"
+#include "../structs/arct.h"
+#include "../structs/arct_data.h"
+#include "../structs/ct_data.h"
+#include "../structs/entity_data.h"
+#include "../structs/entity_gens.h"
+#include "../structs/deferred_cmds.h"
+#include "../structs/sys_schedule.h"
+
+#define MEM_TAG MEM_TAG_CMD_BUF
+
+#define CMD_BUF_CAPACITY_MUL 2
+
+// Commands added without a value have this value offset.
+#define NO_VALUE_OFFSET (~((size_t) 0))
+
+enum CmdType {
+        CMD_CREATE_ENTITY,
+        CMD_DESTROY_ENTITY,
+        CMD_ADD_COMPONENT,
+        CMD_REMOVE_COMPONENT
+};
+
+struct Cmd {
+        enum CmdType type;
+        struct Entity entity;
+        // Only used when adding or removing components.
+        struct Ct ct;
+        // The offset of the value of an added component in "values" of
+        // the buffer, or "NO_VALUE_OFFSET".
+        size_t value_offset;
+};
+
+// Used to sort the commands by entity while keeping the commands of
+// each entity in the order they were recorded.
+struct CmdRef {
+        pcecs_id_t entity_id;
+        size_t cmd_idx;
+};
+
+// Every command of a single entity, merged into one change.
+struct EntityChange {
+        struct Entity entity;
+        // The archetype of "entity" before the change, with ID ==
+        // "PCECS_INVALID_ID" if the change creates it.
+        struct Arct src;
+        // The archetype of "entity" after the change, with ID ==
+        // "PCECS_INVALID_ID" if the change destroys it.
+        struct Arct dest;
+        // The commands of "entity" are referenced by "ref_count"
+        // "CmdRef"s from index "first_ref".
+        size_t first_ref;
+        size_t ref_count;
+};
+
+// Entity IDs are generated by threads recording to separate buffers
+// at the same time, but they all share one ID manager.
+static pthread_mutex_t g_entity_id_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t min_valid_capacity(size_t req_capacity)
+{
+        size_t capacity = 1;
+        while (capacity < req_capacity) {
+                capacity *= CMD_BUF_CAPACITY_MUL;
+        }
+        return capacity;
+}
+
+struct CmdBuf create_cmd_buf(void)
+{
+        return (struct CmdBuf) {
+                .cmds = NULL,
+                .cmd_count = 0,
+                .cmds_capacity = 0,
+                .values = NULL,
+                .values_size = 0,
+                .values_capacity = 0
+        };
+}
+
+void destroy_cmd_buf(struct CmdBuf * cmd_buf)
+{
+        FREE(cmd_buf->cmds);
+        FREE(cmd_buf->values);
+}
+
+static void append_cmd(struct CmdBuf * cmd_buf, struct Cmd cmd)
+{
+        if (cmd_buf->cmd_count == cmd_buf->cmds_capacity) {
+                cmd_buf->cmds_capacity = min_valid_capacity(cmd_buf->cmd_count + 1);
+                REALLOC(&cmd_buf->cmds, struct Cmd, cmd_buf->cmds_capacity);
+        }
+
+        cmd_buf->cmds[cmd_buf->cmd_count] = cmd;
+        ++cmd_buf->cmd_count;
+}
+
+// Copies "size" bytes from "value" to the end of the values of
+// "cmd_buf", returning their offset.
+static size_t append_value(struct CmdBuf * cmd_buf, const void * value, size_t size)
+{
+        size_t offset = cmd_buf->values_size;
+
+        if (offset + size > cmd_buf->values_capacity) {
+                cmd_buf->values_capacity = min_valid_capacity(offset + size);
+                REALLOC(&cmd_buf->values, byte_t, cmd_buf->values_capacity);
+        }
+
+        COPY_MEMORY((byte_t *) cmd_buf->values + offset, value, byte_t, size);
+        cmd_buf->values_size += size;
+        return offset;
+}
+
+struct Entity cmd_create_entity(struct CmdBuf * cmd_buf)
+{
+        // Generations only change when buffers are applied, so they can
+        // be read from any thread while recording.
+        pthread_mutex_lock(&g_entity_id_mutex);
+        struct Entity entity = entity_of_id(generate_id_of_type(ID_MGR_ENTITIES));
+        pthread_mutex_unlock(&g_entity_id_mutex);
+
+        append_cmd(cmd_buf, (struct Cmd) {
+                .type = CMD_CREATE_ENTITY,
+                .entity = entity,
+                .value_offset = NO_VALUE_OFFSET
+        });
+        return entity;
+}
+
+void cmd_destroy_entity(struct CmdBuf * cmd_buf, struct Entity entity)
+{
+        append_cmd(cmd_buf, (struct Cmd) {
+                .type = CMD_DESTROY_ENTITY,
+                .entity = entity,
+                .value_offset = NO_VALUE_OFFSET
+        });
+}
+
+void cmd_add_component(struct CmdBuf * cmd_buf, struct Entity entity, struct Ct ct, const void * value)
+{
+        ASSERT_OR_HANDLE(map_contains(&g_ct_map, ct.id), , "Non-existent " CT_FS ".", CT_FA(ct));
+
+        size_t value_offset = NO_VALUE_OFFSET;
+        if (value != NULL) {
+                const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+                value_offset = append_value(cmd_buf, value, ct_data->size);
+        }
+
+        append_cmd(cmd_buf, (struct Cmd) {
+                .type = CMD_ADD_COMPONENT,
+                .entity = entity,
+                .ct = ct,
+                .value_offset = value_offset
+        });
+}
+
+void cmd_remove_component(struct CmdBuf * cmd_buf, struct Entity entity, struct Ct ct)
+{
+        ASSERT_OR_HANDLE(map_contains(&g_ct_map, ct.id), , "Non-existent " CT_FS ".", CT_FA(ct));
+
+        append_cmd(cmd_buf, (struct Cmd) {
+                .type = CMD_REMOVE_COMPONENT,
+                .entity = entity,
+                .ct = ct,
+                .value_offset = NO_VALUE_OFFSET
+        });
+}
+
+static int compare_ids(pcecs_id_t id1, pcecs_id_t id2)
+{
+        return (id1 > id2) - (id1 < id2);
+}
+
+static int compare_cmd_refs(const void * ref1, const void * ref2)
+{
+        const struct CmdRef * cmd_ref1 = ref1;
+        const struct CmdRef * cmd_ref2 = ref2;
+
+        int entity_order = compare_ids(cmd_ref1->entity_id, cmd_ref2->entity_id);
+        if (entity_order != 0) {
+                return entity_order;
+        }
+        return (cmd_ref1->cmd_idx > cmd_ref2->cmd_idx) - (cmd_ref1->cmd_idx < cmd_ref2->cmd_idx);
+}
+
+static int compare_entity_changes(const void * change1, const void * change2)
+{
+        const struct EntityChange * entity_change1 = change1;
+        const struct EntityChange * entity_change2 = change2;
+
+        int src_order = compare_ids(entity_change1->src.id, entity_change2->src.id);
+        if (src_order != 0) {
+                return src_order;
+        }
+        return compare_ids(entity_change1->dest.id, entity_change2->dest.id);
+}
+
+// Merges the "ref_count" commands referenced from "first_ref" in "refs",
+// which all belong to the same entity, into "change".
+// Returns "false" if the commands don't change any existing entity.
+static bool merge_entity_cmds(
+        const struct CmdBuf * cmd_buf,
+        const struct CmdRef * refs,
+        size_t first_ref,
+        size_t ref_count,
+        struct EntityChange * change)
+{
+        // The entity with this ID if it exists, or the one its creation
+        // commands create.
+        struct Entity entity = entity_of_id(refs[first_ref].entity_id);
+
+        bool exists = entity_gen_alive(entity);
+        bool created = false;
+        bool destroyed = false;
+
+        // The buffers of several threads are merged in thread order (see
+        // "apply_cmd_bufs"), so the creation of an entity may come after
+        // commands recorded for it on another thread. It counts wherever
+        // it is.
+        for (size_t i = first_ref; i < first_ref + ref_count; ++i) {
+                const struct Cmd * cmd = &cmd_buf->cmds[refs[i].cmd_idx];
+                if (cmd->type == CMD_CREATE_ENTITY && cmd->entity.generation == entity.generation) {
+                        created = true;
+                }
+        }
+
+        // The component types of "entity" once the commands are done.
+        struct CtSet cts = create_ct_set();
+        change->src.id = PCECS_INVALID_ID;
+        if (exists) {
+                const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+                const struct ArctData * arct_data = get_map_element(&g_arct_map, entity_data->arct.id);
+
+                copy_ct_set(&cts, &arct_data->ct_set);
+                change->src = entity_data->arct;
+        }
+
+        for (size_t i = first_ref; i < first_ref + ref_count && !destroyed; ++i) {
+                const struct Cmd * cmd = &cmd_buf->cmds[refs[i].cmd_idx];
+
+                // Commands recorded for a destroyed entity whose ID has
+                // been reused don't apply to the new entity.
+                if (cmd->entity.generation != entity.generation) {
+                        continue;
+                }
+
+                switch (cmd->type) {
+                case CMD_CREATE_ENTITY:
+                        break;
+                case CMD_DESTROY_ENTITY:
+                        destroyed = true;
+                        break;
+                case CMD_ADD_COMPONENT:
+                        if (!ct_in_set(&cts, cmd->ct)) {
+                                add_ct_to_set(&cts, cmd->ct);
+                        }
+                        break;
+                case CMD_REMOVE_COMPONENT:
+                        if (ct_in_set(&cts, cmd->ct)) {
+                                remove_ct_from_set(&cts, cmd->ct);
+                        }
+                        break;
+                }
+        }
+
+        bool changed = exists || created;
+        if (!changed) {
+                // Every command was recorded with a stale handle of an
+                // entity destroyed before.
+                LOG_DEBUG("Skipping commands of non-existent " ENTITY_FS ".\n", ENTITY_FA(entity));
+        } else if (destroyed && !exists) {
+                // Created and destroyed by the same commands, so only its ID
+                // was ever used. Its generation is still bumped, since its
+                // handle was given out.
+                kill_entity_gen(entity.id);
+                destroy_id_of_type(ID_MGR_ENTITIES, entity.id);
+                changed = false;
+        } else if (destroyed) {
+                change->dest.id = PCECS_INVALID_ID;
+        } else {
+                change->dest = create_arct(&cts);
+        }
+
+        destroy_ct_set(&cts);
+
+        change->entity = entity;
+        change->first_ref = first_ref;
+        change->ref_count = ref_count;
+        return changed;
+}
+
+// Merges the commands of "cmd_buf" into one change per entity, sorted
+// by old and then new archetype. The commands of change "i" are
+// referenced by "refs" (see "struct EntityChange").
+static struct EntityChange * create_entity_changes(
+        const struct CmdBuf * cmd_buf,
+        struct CmdRef ** refs,
+        size_t * change_count)
+{
+        *refs = ALLOC(struct CmdRef, cmd_buf->cmd_count);
+        for (size_t i = 0; i < cmd_buf->cmd_count; ++i) {
+                (*refs)[i] = (struct CmdRef) {
+                        .entity_id = cmd_buf->cmds[i].entity.id,
+                        .cmd_idx = i
+                };
+        }
+        qsort(*refs, cmd_buf->cmd_count, sizeof(struct CmdRef), compare_cmd_refs);
+
+        // There's at most one change for every command.
+        struct EntityChange * changes = ALLOC(struct EntityChange, cmd_buf->cmd_count);
+        *change_count = 0;
+
+        size_t first_ref = 0;
+        while (first_ref < cmd_buf->cmd_count) {
+                size_t ref_count = 1;
+                while (first_ref + ref_count < cmd_buf->cmd_count &&
+                       (*refs)[first_ref + ref_count].entity_id == (*refs)[first_ref].entity_id)
+                {
+                        ++ref_count;
+                }
+
+                if (merge_entity_cmds(cmd_buf, *refs, first_ref, ref_count, &changes[*change_count])) {
+                        ++*change_count;
+                }
+                first_ref += ref_count;
+        }
+
+        qsort(changes, *change_count, sizeof(struct EntityChange), compare_entity_changes);
+        return changes;
+}
+
+// Returns the number of the first "count" changes of "changes" that
+// have the same old and new archetypes as the first one.
+static size_t entity_change_group_size(const struct EntityChange * changes, size_t count)
+{
+        size_t group_size = 1;
+        while (group_size < count && arcts_equal(changes[group_size].src, changes[0].src) &&
+               arcts_equal(changes[group_size].dest, changes[0].dest))
+        {
+                ++group_size;
+        }
+        return group_size;
+}
+
+// Moves, creates or destroys the entities of the "count" changes of
+// "changes", which all have the same old and new archetypes. Entities
+// are created and moved all at once, so each column is only resized
+// once and moved one run of rows at a time.
+static void apply_entity_changes_structure(const struct EntityChange * changes, size_t count)
+{
+        struct Arct src = changes[0].src;
+        struct Arct dest = changes[0].dest;
+
+        if (dest.id == PCECS_INVALID_ID) {
+                for (size_t i = 0; i < count; ++i) {
+                        remove_entity_from_arct(changes[i].entity);
+                        destroy_id_of_type(ID_MGR_ENTITIES, changes[i].entity.id);
+                }
+                return;
+        }
+        if (arcts_equal(src, dest)) {
+                return;
+        }
+
+        struct Entity * entities = ALLOC(struct Entity, count);
+        for (size_t i = 0; i < count; ++i) {
+                entities[i] = changes[i].entity;
+        }
+
+        if (src.id == PCECS_INVALID_ID) {
+                add_entities_to_arct(entities, count, dest);
+        } else {
+                move_entities_to_arct(entities, count, dest);
+        }
+
+        FREE(entities);
+}
+
+// Returns "true" if a command after the one referenced by index
+// "ref_idx" in "refs" adds or removes the same component type, before
+// the end of "change".
+static bool ct_changed_later(
+        const struct CmdBuf * cmd_buf,
+        const struct CmdRef * refs,
+        const struct EntityChange * change,
+        size_t ref_idx)
+{
+        struct Ct ct = cmd_buf->cmds[refs[ref_idx].cmd_idx].ct;
+
+        for (size_t i = ref_idx + 1; i < change->first_ref + change->ref_count; ++i) {
+                const struct Cmd * cmd = &cmd_buf->cmds[refs[i].cmd_idx];
+
+                bool changes_ct = cmd->type == CMD_ADD_COMPONENT || cmd->type == CMD_REMOVE_COMPONENT;
+                if (changes_ct && cts_equal(cmd->ct, ct)) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+// Sets the components added with values by the commands of "change",
+// which must have moved its entity already.
+static void set_entity_change_values(
+        const struct CmdBuf * cmd_buf,
+        const struct CmdRef * refs,
+        const struct EntityChange * change)
+{
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, change->dest.id);
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, change->entity.id);
+
+        for (size_t i = change->first_ref; i < change->first_ref + change->ref_count; ++i) {
+                const struct Cmd * cmd = &cmd_buf->cmds[refs[i].cmd_idx];
+
+                // Only the last value of a component type counts.
+                if (cmd->type != CMD_ADD_COMPONENT || cmd->value_offset == NO_VALUE_OFFSET ||
+                    ct_changed_later(cmd_buf, refs, change, i))
+                {
+                        continue;
+                }
+
+                const struct CtData * ct_data = get_map_element(&g_ct_map, cmd->ct.id);
+                void * component = get_table_component(&arct_data->ctable, entity_data->row, cmd->ct);
+                COPY_MEMORY(component, (byte_t *) cmd_buf->values + cmd->value_offset, byte_t, ct_data->size);
+        }
+}
+
+struct CmdBuf * get_sys_cmd_buf(void)
+{
+        return deferred_cmd_buf();
+}
+
+// Appends the commands and values of "src" to "dest".
+static void append_cmd_buf(struct CmdBuf * dest, const struct CmdBuf * src)
+{
+        size_t values_offset = dest->values_size;
+        if (src->values_size > 0) {
+                append_value(dest, src->values, src->values_size);
+        }
+
+        if (dest->cmd_count + src->cmd_count > dest->cmds_capacity) {
+                dest->cmds_capacity = min_valid_capacity(dest->cmd_count + src->cmd_count);
+                REALLOC(&dest->cmds, struct Cmd, dest->cmds_capacity);
+        }
+
+        for (size_t i = 0; i < src->cmd_count; ++i) {
+                struct Cmd cmd = src->cmds[i];
+                if (cmd.value_offset != NO_VALUE_OFFSET) {
+                        cmd.value_offset += values_offset;
+                }
+                dest->cmds[dest->cmd_count + i] = cmd;
+        }
+        dest->cmd_count += src->cmd_count;
+}
+
+void apply_cmd_buf(struct CmdBuf * cmd_buf)
+{
+        apply_cmd_bufs(cmd_buf, 1);
+}
+
+void apply_cmd_bufs(struct CmdBuf * cmd_bufs, size_t count)
+{
+        ASSERT_OR_HANDLE(deferred_cmd_buf() == NULL, , "Cannot apply command buffers while systems are running.");
+        ASSERT(!sys_schedule_running(), "Cannot apply command buffers while systems run on several threads.");
+
+        // Take the commands out of "cmd_bufs", so that they can be recorded
+        // to by the start and destroy functions called below. The first
+        // buffer with any commands is taken as it is, and the rest are
+        // appended to it.
+        struct CmdBuf cmds = create_cmd_buf();
+        for (size_t i = 0; i < count; ++i) {
+                if (cmd_bufs[i].cmd_count == 0) {
+                        continue;
+                }
+
+                if (cmds.cmd_count == 0) {
+                        cmds = cmd_bufs[i];
+                } else {
+                        append_cmd_buf(&cmds, &cmd_bufs[i]);
+                        destroy_cmd_buf(&cmd_bufs[i]);
+                }
+                cmd_bufs[i] = create_cmd_buf();
+        }
+
+        if (cmds.cmd_count == 0) {
+                return;
+        }
+
+        LOG_DEBUG("Applying %d command buffers as " CMD_BUF_FS " ...\n", (int) count, CMD_BUF_FA(cmds));
+
+        // Changes made by the start and destroy functions are applied
+        // after these ones, so that no entity is moved twice below.
+        begin_deferring_cmds();
+
+        struct CmdRef * refs;
+        size_t change_count;
+        struct EntityChange * changes = create_entity_changes(&cmds, &refs, &change_count);
+
+        size_t group_start = 0;
+        while (group_start < change_count) {
+                size_t group_size = entity_change_group_size(changes + group_start, change_count - group_start);
+                apply_entity_changes_structure(changes + group_start, group_size);
+                group_start += group_size;
+        }
+
+        for (size_t i = 0; i < change_count; ++i) {
+                if (changes[i].dest.id != PCECS_INVALID_ID) {
+                        set_entity_change_values(&cmds, refs, &changes[i]);
+                }
+        }
+
+        // Every entity is in its new archetype with its new values now,
+        // so the start functions see all of them.
+        for (size_t i = 0; i < change_count; ++i) {
+                const struct EntityChange * change = &changes[i];
+                if (change->dest.id != PCECS_INVALID_ID && !arcts_equal(change->src, change->dest)) {
+                        start_entity_systems(change->entity, change->src);
+                }
+        }
+
+        FREE(changes);
+        FREE(refs);
+        destroy_cmd_buf(&cmds);
+
+        end_deferring_cmds();
+
+        LOG_DEBUG("Applied command buffer.\n");
+}
@@ -0,0 +1,88 @@
+// Command buffers record structural changes -- creating and destroying
+// entities, and adding and removing components -- so that they can be
+// carried out later, all at once.
+// Structural changes move entities between the tables of archetypes,
+// which can't happen while systems are reading those tables. Changes
+// made by system functions through "create_entity", "destroy_entity",
+// "add_component" and "remove_component" are therefore recorded in a
+// command buffer of the thread running the system, and applied once
+// the systems are done (see "update_entities" and "draw_entities").
+// Command buffers can also be used directly, for instance to fill one
+// buffer per thread and apply them together at a point of your own
+// choosing (see "apply_cmd_bufs").
+
+#ifndef CMD_BUF_H
+#define CMD_BUF_H
+
+#include <stddef.h>
+#include "entity.h"
+#include "ct.h"
+
+#define CMD_BUF_FS "command buffer (%d commands)"
+#define CMD_BUF_FA(cmd_buf) (int) (cmd_buf).cmd_count
+
+// A single recorded change. Only used by the implementation.
+struct Cmd;
+
+struct CmdBuf {
+        struct Cmd * cmds;
+        size_t cmd_count;
+        size_t cmds_capacity;
+
+        // The values given to "cmd_add_component", one after another.
+        void * values;
+        size_t values_size;
+        size_t values_capacity;
+};
+
+// Creates an empty command buffer.
+struct CmdBuf create_cmd_buf(void);
+
+// Frees the resources allocated by "cmd_buf" without applying it.
+void destroy_cmd_buf(struct CmdBuf * cmd_buf);
+
+// Records the creation of an entity with no components, returning the
+// entity it will be. The entity doesn't exist until "cmd_buf" is
+// applied, but it can be given to the other functions recording to
+// "cmd_buf".
+// The ID of the entity is generated at once, which is safe to do from
+// several threads recording to separate buffers at the same time.
+struct Entity cmd_create_entity(struct CmdBuf * cmd_buf);
+
+// Records the destruction of "entity". Commands recorded for "entity"
+// after this one are ignored.
+void cmd_destroy_entity(struct CmdBuf * cmd_buf, struct Entity entity);
+
+// Records the addition of "ct" to "entity". The component is set to a
+// copy of "value", or contains junk data if "value" is NULL.
+// If "entity" already contains "ct" when the buffer is applied, only
+// the value is set.
+void cmd_add_component(struct CmdBuf * cmd_buf, struct Entity entity, struct Ct ct, const void * value);
+
+// Records the removal of "ct" from "entity". Nothing happens if
+// "entity" doesn't contain "ct" when the buffer is applied.
+void cmd_remove_component(struct CmdBuf * cmd_buf, struct Entity entity, struct Ct ct);
+
+// Returns the buffer that the structural changes of the system function
+// calling it are recorded to, or NULL if it's not called by a system
+// function. Recording to it directly is mostly useful for setting the
+// values of added components with "cmd_add_component".
+struct CmdBuf * get_sys_cmd_buf(void);
+
+// Carries out every change recorded in "cmd_buf" and empties it.
+// All the commands of one entity are merged first, so an entity is
+// moved at most once no matter how many of its components change.
+// The entities are then moved in groups with the same old and new
+// archetypes, and each group is moved one run of rows at a time.
+// Start functions are called once every entity is in its new archetype
+// with its new values.
+// Cannot be called while systems are running.
+void apply_cmd_buf(struct CmdBuf * cmd_buf);
+
+// Same as "apply_cmd_buf" for the "count" buffers of "cmd_bufs" at
+// once, as if their commands had been recorded to one buffer in order.
+// Buffers filled by several threads must be applied this way, since an
+// entity created in one of them may be changed in the others.
+void apply_cmd_bufs(struct CmdBuf * cmd_bufs, size_t count);
+
+#endif
@@ -11,18 +11,34 @@ void noop(void * arg)
 }
 
 struct Ct create_ct(size_t size, void (* destructor)(void *))
+{
+        // Columns start at addresses aligned to at least
+        // "COLUMN_ALIGNMENT" anyway (see "column.h"), which is as
+        // aligned as components of any size can be without padding.
+        return create_ct_aligned(size, 1, destructor);
+}
+
+struct Ct create_ct_aligned(size_t size, size_t alignment, void (* destructor)(void *))
 {
         LOG_DEBUG("Creating component type ...\n");
 
+        ASSERT_OR_HANDLE(alignment != 0 && (alignment & (alignment - 1)) == 0,
+                (struct Ct) {.id = PCECS_INVALID_ID},
+                "Component type alignment %d is not a power of two.", (int) alignment);
+
+        ASSERT_OR_HANDLE(size % alignment == 0, (struct Ct) {.id = PCECS_INVALID_ID},
+                "Component type size %d is not a multiple of its alignment %d.",
+                (int) size, (int) alignment);
+
         struct Ct ct = {
-                .id = generate_id_of_type(ID_MGR_CTS)
+                .id = (ct_id_t) generate_id_of_type(ID_MGR_CTS)
         };
 
         // Create underlying data for the new component type, and
         // add it to the global component type map.
         // If no destructor is provided, simply don't destroy by
         // passing a no-op as the "destructor" argument.
-        struct CtData data = create_ct_data(size, destructor ? destructor : noop);
+        struct CtData data = create_ct_data(size, alignment, destructor ? destructor : noop);
         add_to_map(&g_ct_map, ct.id, &data);
 
         LOG_INFO("Created " CT_FS ".\n", CT_FA(ct));
@@ -14,14 +14,14 @@
 #include <stddef.h>
 #include "../ids/id.h"
 
-#define CT_FS "component type (" PCECS_ID_FS ")"
-#define CT_FA(component_type) PCECS_ID_FA(component_type.id)
+#define CT_FS "component type (" CT_ID_FS ")"
+#define CT_FA(component_type) CT_ID_FA(component_type.id)
 
 // "struct Ct" is simply an interface, but it
 // has data belonging to it in the underlying implementation
 // (see "ct_data.h").
 struct Ct {
-        pcecs_id_t id;
+        ct_id_t id;
 };
 
 // Creates a new component type. "size" is the size of a
@@ -31,6 +31,14 @@ struct Ct {
 // pointer as its parameter.
 struct Ct create_ct(size_t size, void (* destructor)(void *));
 
+// Same as "create_ct", but every component of the type is placed at an
+// address that's a multiple of "alignment", for instance so that they
+// can be loaded by aligned SIMD instructions. "alignment" must be a
+// power of two, and "size" must be a multiple of it.
+// Components of types created by "create_ct" are only as aligned as
+// their size allows.
+struct Ct create_ct_aligned(size_t size, size_t alignment, void (* destructor)(void *));
+
 // Checks if two component types are the same.
 // Will return false if the arguments are referring to
 // two different component types, even if their
@@ -39,8 +47,7 @@ bool cts_equal(struct Ct ct1, struct Ct ct2);
 
 // Component types cannot be destroyed because to do so, one would
 // have to destroy any archetypes containing the component type,
-// and archetypes cannot be destroyed since that would require
-// cleaning up a lot of data in a lot of places referencing the
-// archetype.
+// and archetypes are only destroyed once they've been empty for a
+// while (see "destroy_empty_archetypes"), not on demand.
 
 #endif
@@ -2,17 +2,32 @@
 #include <stdbool.h>
 #include "../interface/ct.h"
 #include "../tools/debug.h"
-#include "../tools/byte.h"
+#include "../tools/bits.h"
 #include "../globals/maps.h"
 #include "../tools/mem_tools.h"
 
-#define BITS_IN_BYTE CHAR_BIT
+#define MEM_TAG MEM_TAG_CT_SET
+
+static bool ct_set_on_heap(const struct CtSet * set)
+{
+        return set->word_count > CT_SET_INLINE_WORDS;
+}
+
+static ct_set_word_t * ct_set_words(struct CtSet * set)
+{
+        return ct_set_on_heap(set) ? set->heap_words : set->inline_words;
+}
+
+static const ct_set_word_t * const_ct_set_words(const struct CtSet * set)
+{
+        return ct_set_on_heap(set) ? set->heap_words : set->inline_words;
+}
 
 struct CtSet create_ct_set(void)
 {
-        struct CtSet ct_set;
-        ct_set.size = 0;
-        ct_set.contents = ALLOC(byte_t, ct_set.size);
+        // Empty sets fit inline, so nothing is allocated until
+        // the set outgrows "CT_SET_INLINE_WORDS".
+        struct CtSet ct_set = {0};
 
         LOG_DEBUG("Created " CT_SET_FS ".\n",
                 CT_SET_FA(ct_set));
@@ -21,42 +36,77 @@ struct CtSet create_ct_set(void)
 
 void destroy_ct_set(struct CtSet * ct_set)
 {
-        FREE(ct_set->contents);
+        if (ct_set_on_heap(ct_set)) {
+                FREE(ct_set->heap_words);
+        }
 }
 
 void copy_ct_set(struct CtSet * dest, const struct CtSet * src)
 {
         LOG_DEBUG("Copying " CT_SET_FS ".\n", CT_SET_FA(src));
 
-        FREE(dest->contents);
+        destroy_ct_set(dest);
         *dest = *src;
-        dest->contents = ALLOC(byte_t, dest->size);
-        COPY_MEMORY(dest->contents, src->contents, byte_t, dest->size);
+        if (ct_set_on_heap(src)) {
+                dest->word_capacity = src->word_count;
+                dest->heap_words = ALLOC(ct_set_word_t, dest->word_capacity);
+                COPY_MEMORY(dest->heap_words, src->heap_words, ct_set_word_t, dest->word_count);
+        }
 }
 
-static void resize_ct_set(struct CtSet * set, size_t size)
+// Moves the words of "set" to the heap, or grows the words on the heap,
+// so that there's space for at least "word_count" words.
+static void grow_heap_words(struct CtSet * set, size_t word_count)
 {
-        LOG_DEBUG("Resizing " CT_SET_FS " from size %d to %d.\n",
-                CT_SET_FA(set), (int) set->size, (int) size);
-
-        REALLOC(&set->contents, byte_t, size);
-        size_t prev_size = set->size;
-        set->size = size;
-
-        // If any new bytes were allocated
-        if (set->size > prev_size) {
-                // All  new bits set to 0 since component type sets
-                // include no components beyond their size, so when
-                // it's resized none of the new component types it
-                // has space for are actually in it.
-                // The newly allocated bytes start on the element
-                // after what was previously the last element
-                // (&set->contents[(prev_size - 1) + 1])
-                // The amount of newly allocated bytes equals the
-                // previous length subtracted from the new length.
-                byte_t * first_new_byte = &set->contents[prev_size];
-                size_t new_bytes_count = set->size - prev_size;
-                SET_MEMORY(first_new_byte, 0, byte_t, new_bytes_count);
+        // Double the capacity so adding component types with ever
+        // larger IDs reallocates only a logarithmic number of times.
+        size_t capacity = ct_set_on_heap(set) ? set->word_capacity * 2 : CT_SET_INLINE_WORDS * 2;
+        if (capacity < word_count) {
+                capacity = word_count;
+        }
+
+        if (ct_set_on_heap(set)) {
+                REALLOC(&set->heap_words, ct_set_word_t, capacity);
+        } else {
+                ct_set_word_t * heap_words = ALLOC(ct_set_word_t, capacity);
+                COPY_MEMORY(heap_words, set->inline_words, ct_set_word_t, set->word_count);
+                set->heap_words = heap_words;
+        }
+        set->word_capacity = capacity;
+}
+
+// Moves the words of "set" back into the set, once it's small enough
+// for them to fit.
+static void move_heap_words_inline(struct CtSet * set, size_t word_count)
+{
+        ct_set_word_t * heap_words = set->heap_words;
+        COPY_MEMORY(set->inline_words, heap_words, ct_set_word_t, word_count);
+        FREE(heap_words);
+        set->word_capacity = 0;
+}
+
+static void resize_ct_set(struct CtSet * set, size_t word_count)
+{
+        LOG_DEBUG("Resizing " CT_SET_FS " from %d to %d words.\n",
+                CT_SET_FA(set), (int) set->word_count, (int) word_count);
+
+        size_t prev_word_count = set->word_count;
+        bool fits_inline = word_count <= CT_SET_INLINE_WORDS;
+        if (!fits_inline && (!ct_set_on_heap(set) || word_count > set->word_capacity)) {
+                grow_heap_words(set, word_count);
+        } else if (fits_inline && ct_set_on_heap(set)) {
+                move_heap_words_inline(set, word_count);
+        }
+        // Sets on the heap keep their capacity when they shrink, so
+        // that removing component types doesn't reallocate.
+        set->word_count = word_count;
+
+        // Component type sets include no components beyond their
+        // size, so none of the component types the new words have
+        // space for are actually in the set.
+        if (set->word_count > prev_word_count) {
+                SET_MEMORY(&ct_set_words(set)[prev_word_count], 0, ct_set_word_t,
+                        set->word_count - prev_word_count);
         }
 }
 
@@ -67,125 +117,140 @@ struct CtSet ct_set_union(const struct CtSet * set1, const struct CtSet * set2)
 
         // If the sets have the same size, it doesn't matter which
         // set is assigned to which of these two variables.
-        const struct CtSet * largest_set = set1->size > set2->size ? set1 : set2;
+        const struct CtSet * largest_set = set1->word_count > set2->word_count ? set1 : set2;
         const struct CtSet * smallest_set = largest_set == set1 ? set2 : set1;
 
         // Make the new set equal the largest one of the sets, and
         // add the components from the smaller set by bitwise-or-ing
-        // it with that one. The smaller set is guaranteed to have a
-        // size smaller or equal to the longer one, so "smallest_set->
-        // size" is not out of bounds.
+        // it with that one. The last word of the largest set is not
+        // 0, so neither is the last word of the union.
         struct CtSet new_set = create_ct_set();
         copy_ct_set(&new_set, largest_set);
 
-        for (size_t i = 0; i < smallest_set->size; ++i) {
-                new_set.contents[i] |= smallest_set->contents[i];
+        ct_set_word_t * new_words = ct_set_words(&new_set);
+        const ct_set_word_t * smallest_words = const_ct_set_words(smallest_set);
+        for (size_t i = 0; i < smallest_set->word_count; ++i) {
+                new_words[i] |= smallest_words[i];
         }
         return new_set;
 }
 
-static void remove_trailing_null_bytes(struct CtSet * set)
+static void remove_trailing_null_words(struct CtSet * set)
 {
-        LOG_DEBUG("Removing trailing null bytes from " CT_SET_FS ".\n",
+        LOG_DEBUG("Removing trailing null words from " CT_SET_FS ".\n",
                 CT_SET_FA(*set));
 
-        size_t bytes_to_remove = 0;
-        while (set->contents[set->size - bytes_to_remove - 1] == 0x0) {
-                ++bytes_to_remove;
+        const ct_set_word_t * words = ct_set_words(set);
+        size_t word_count = set->word_count;
+        while (word_count != 0 && words[word_count - 1] == 0) {
+                --word_count;
         }
-        if (bytes_to_remove != 0) {
-                resize_ct_set(set, set->size - bytes_to_remove);
+        if (word_count != set->word_count) {
+                resize_ct_set(set, word_count);
         }
 }
 
-static size_t ct_set_bit_count(const struct CtSet * set)
+static size_t idx_of_word(pcecs_id_t id)
+{
+        return (size_t) id / CT_SET_WORD_BITS;
+}
+
+static ct_set_word_t bit_within_word(pcecs_id_t id)
 {
-        return set->size * BITS_IN_BYTE;
+        return (ct_set_word_t) 1 << (id % CT_SET_WORD_BITS);
 }
 
-static size_t idx_of_byte(struct Ct ct)
+static pcecs_id_t id_of_bit(size_t word_idx, int bit_idx)
 {
-        return (size_t) ct.id / BITS_IN_BYTE;
+        return (pcecs_id_t) (word_idx * CT_SET_WORD_BITS + (size_t) bit_idx);
 }
 
-// LSB is index 0, MSB is index 7.
-// That might seem strange since the bits in a component type
-// set will end up reading backwards compared to the bytes,
-// but it's reasonable to work with since bit indices and byte
-// indices are split into different routines, and
-// "1 << idx_of_bit_within_byte(ct)"
-// is much easier to work with than
-// "(1 << (BITS_IN_BYTE - 1)) >> idx_of_bit_within_byte(ct)".
-static int idx_of_bit_within_byte(struct Ct ct)
+struct CtSet ct_set_difference(const struct CtSet * set1, const struct CtSet * set2)
 {
-        return (int) ct.id % BITS_IN_BYTE;
+        LOG_DEBUG("Finding the difference of " CT_SET_FS " and " CT_SET_FS ".\n",
+                CT_SET_FA(set1), CT_SET_FA(set2));
+
+        struct CtSet new_set = create_ct_set();
+        copy_ct_set(&new_set, set1);
+
+        // Words of "set2" beyond the end of "set1" have nothing to
+        // remove.
+        size_t shared_count = set1->word_count < set2->word_count ?
+                set1->word_count : set2->word_count;
+
+        ct_set_word_t * new_words = ct_set_words(&new_set);
+        const ct_set_word_t * words2 = const_ct_set_words(set2);
+        for (size_t i = 0; i < shared_count; ++i) {
+                new_words[i] &= ~words2[i];
+        }
+        remove_trailing_null_words(&new_set);
+        return new_set;
 }
 
 bool ct_in_set(const struct CtSet * set, struct Ct ct)
 {
-        if ((size_t) ct.id > ct_set_bit_count(set)) {
+        size_t word_idx = idx_of_word(ct.id);
+        if (word_idx >= set->word_count) {
                 return false;
         }
-        byte_t ct_byte = set->contents[idx_of_byte(ct)];
-        byte_t ct_bit = (ct_byte >> idx_of_bit_within_byte(ct)) & 1;
-        return ct_bit ? true : false;
+        return (const_ct_set_words(set)[word_idx] & bit_within_word(ct.id)) != 0;
 }
 
 bool ct_set_in_set(const struct CtSet * subset, const struct CtSet * superset)
 {
-        // CtSet-s are guaranteed to have no trailing null bytes,
+        // CtSet-s are guaranteed to have no trailing null words,
         // so if one set is longer than the other, it's guaranteed
         // to have a 1 bit than the other doesn't have and is
         // therefore not a subset.
-        if (subset->size > superset->size) {
+        if (subset->word_count > superset->word_count) {
                 return false;
         }
 
-        for (size_t i = 0; i < subset->size; ++i) {
-                // Finds all the bits subset[i] has and superset[i] hasn't.
-                // None of those bits are supposed to exist, of course, so
-                // if the result isn't a null byte, "subset" isn't a subset.
-                if (subset->contents[i] & ~superset->contents[i]) {
-                        return false;
-                }
+        // Or together the bits "subset" has and "superset" hasn't,
+        // rather than returning at the first one, so that the loop
+        // has no branches and can be vectorized.
+        const ct_set_word_t * subset_words = const_ct_set_words(subset);
+        const ct_set_word_t * superset_words = const_ct_set_words(superset);
+        ct_set_word_t missing = 0;
+        for (size_t i = 0; i < subset->word_count; ++i) {
+                missing |= subset_words[i] & ~superset_words[i];
         }
-        return true;
+        return missing == 0;
 }
 
 bool ct_sets_equal(const struct CtSet * set1, const struct CtSet * set2)
 {
-        // There are no trailing null bytes in sets, so equal
+        // There are no trailing null words in sets, so equal
         // sets have equal length
-        if (set1->size != set2->size) {
+        if (set1->word_count != set2->word_count) {
                 return false;
         }
 
-        return MEMORY_EQUALS(set1->contents, set2->contents, byte_t, set1->size);
+        return MEMORY_EQUALS(const_ct_set_words(set1), const_ct_set_words(set2), ct_set_word_t,
+                set1->word_count);
 }
 
-bool ct_set_empty(const struct CtSet * set)
+bool ct_sets_intersect(const struct CtSet * set1, const struct CtSet * set2)
 {
-        // Sets are no larger than they need to be, so any non-empty
-        // set has a size of 0.
-        return set->size == 0;
+        // Words beyond the end of the smallest set contain no component
+        // types, so they can't be in both sets.
+        size_t shared_count = set1->word_count < set2->word_count ?
+                set1->word_count : set2->word_count;
+
+        const ct_set_word_t * words1 = const_ct_set_words(set1);
+        const ct_set_word_t * words2 = const_ct_set_words(set2);
+        ct_set_word_t shared = 0;
+        for (size_t i = 0; i < shared_count; ++i) {
+                shared |= words1[i] & words2[i];
+        }
+        return shared != 0;
 }
 
-// All are aware brainy Brian brought counting computer code.
-static size_t kernighan_bit_count(byte_t byte)
+bool ct_set_empty(const struct CtSet * set)
 {
-        byte_t bits_left = byte;
-        size_t count = 0;
-        while (bits_left)
-        {
-                // The subtraction will remove the least significant 1 bit
-                // by carrying it to all the 0 bits before it. By bitwise
-                // and-ing this value by the actual number, we remove that
-                // 1 bit and keep the 0s behind it off.
-                bits_left &= bits_left - 1;
-                ++count;
-        }
-
-        return count;
+        // Sets are no larger than they need to be, so only the
+        // empty set has no words.
+        return set->word_count == 0;
 }
 
 size_t cts_in_set_count(const struct CtSet * set)
@@ -193,13 +258,32 @@ size_t cts_in_set_count(const struct CtSet * set)
         // Each bit in the set represents a component type, so
         // the total number of component types in the set equals
         // the total number of 1 bits.
+        const ct_set_word_t * words = const_ct_set_words(set);
         size_t count = 0;
-        for (size_t i = 0; i < set->size; ++i) {
-                count += kernighan_bit_count(set->contents[i]);
+        for (size_t i = 0; i < set->word_count; ++i) {
+                count += (size_t) POPCOUNT_64(words[i]);
         }
         return count;
 }
 
+uint64_t ct_set_hash(const struct CtSet * set)
+{
+        // Mixes in one word at a time with the MurmurHash3 finalizer
+        // steps, so that the low bits of the hash depend on every bit of
+        // every word. There are no trailing null words, so sets with the
+        // same component types hash the same words.
+        const ct_set_word_t * words = const_ct_set_words(set);
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < set->word_count; ++i) {
+                hash ^= words[i];
+                hash *= 0xff51afd7ed558ccdULL;
+                hash ^= hash >> 33;
+        }
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+}
+
 void add_ct_to_set(struct CtSet * set, struct Ct ct)
 {
         LOG_DEBUG("Adding " CT_FS " to " CT_SET_FS ".\n",
@@ -210,16 +294,14 @@ void add_ct_to_set(struct CtSet * set, struct Ct ct)
 
         ASSERT_OR_HANDLE(!ct_in_set(set, ct), , "Ct already in set.");
 
-        if ((size_t) ct.id >= ct_set_bit_count(set)) {
-                // The component type set must be large enough to
-                // reference the byte at the index of "ct". Since
-                // arrays are 0-indexed, the size must be one element
-                // longer than the index of the last element.
-                resize_ct_set(set, (size_t) idx_of_byte(ct) + 1);
+        size_t word_idx = idx_of_word(ct.id);
+        if (word_idx >= set->word_count) {
+                // The set must be large enough to reference the
+                // word at the index of "ct".
+                resize_ct_set(set, word_idx + 1);
         }
 
-        byte_t * ct_byte = &set->contents[idx_of_byte(ct)];
-        *ct_byte |= 1 << idx_of_bit_within_byte(ct);
+        ct_set_words(set)[word_idx] |= bit_within_word(ct.id);
 }
 
 void add_ct_list_to_set(struct CtSet * set, struct Ct * list, size_t count)
@@ -240,61 +322,49 @@ void remove_ct_from_set(struct CtSet * set, struct Ct ct)
         ASSERT_OR_HANDLE(ct_in_set(set, ct), , "No " CT_FS " in " CT_SET_FS ".",
                 CT_FA(ct), CT_SET_FA(*set));
 
-        byte_t * ct_byte = &set->contents[idx_of_byte(ct)];
-        *ct_byte &= ~(1 << idx_of_bit_within_byte(ct));
+        ct_set_words(set)[idx_of_word(ct.id)] &= ~bit_within_word(ct.id);
 
-        remove_trailing_null_bytes(set);
+        remove_trailing_null_words(set);
 }
 
-struct Ct first_ct_in_set(const struct CtSet * set)
+// The first component type in the words of "set" from "word_idx" on,
+// with the bits of "word_idx" not in "first_word_mask" ignored.
+static struct Ct first_ct_from_word(const struct CtSet * set, size_t word_idx,
+        ct_set_word_t first_word_mask)
 {
-        // Start at ID 0 and increment it until a component
-        // type with that ID is found in "set".
-        // Stops iterating if the end of the set is reached.
-        for (size_t i = 0; i < set->size * BITS_IN_BYTE; ++i) {
-                struct Ct ct = {
-                        .id = i
-                };
-
-                if (ct_in_set(set, ct)) {
-                        return ct;
+        if (word_idx < set->word_count) {
+                // Skip whole words of absent component types, then find
+                // the lowest 1 bit of the first word that has any.
+                const ct_set_word_t * words = const_ct_set_words(set);
+                ct_set_word_t word = words[word_idx] & first_word_mask;
+                while (word == 0 && ++word_idx < set->word_count) {
+                        word = words[word_idx];
+                }
+                if (word != 0) {
+                        return (struct Ct) {
+                                .id = (ct_id_t) id_of_bit(word_idx, CTZ_64(word))
+                        };
                 }
         }
 
-        // End of set reached; no component type found.
-        // This should really only happen if the set has
-        // size 0 since "ct_set"s are guaranteed to be no
-        // larger than they absolutely need to be, and any
-        // size is too large for no component types.
-        ASSERT(set->size == 0, "Non-zero size (%d) of " CT_SET_FS ", but no component types.",
-                CT_SET_FA(*set));
-
+        // Next type not found; return component type with
+        // invalid (never generated by "IdMgr"s ID.
         return (struct Ct) {
                 .id = PCECS_INVALID_ID
         };
 }
 
-struct Ct next_ct_in_set(const struct CtSet * set, struct Ct start_ct)
+struct Ct first_ct_in_set(const struct CtSet * set)
 {
-        // From the component type right after "start_ct"
-        // until the end of the component type set, loop
-        // through each possible ID and return a component
-        // type with that ID if it's in the set.
-        size_t ct_id = (size_t) start_ct.id + 1;
-        while (ct_id < set->size * BITS_IN_BYTE) {
-                struct Ct ct = {
-                        .id = ct_id
-                };
-
-                if (ct_in_set(set, ct)) {
-                        return ct;
-                }
-                ++ct_id;
-        }
+        return first_ct_from_word(set, 0, ~(ct_set_word_t) 0);
+}
 
-        // Next type not found; return component type with
-        // invalid (never generated by "IdMgr"s ID.
-        return (struct Ct) {
-                .id = PCECS_INVALID_ID
-        };
+struct Ct next_ct_in_set(const struct CtSet * set, struct Ct start_ct)
+{
+        // Every bit of the word of "start_ct" above its own bit.
+        // "start_ct" may have been the last component type of the
+        // set and removed since, so its word may be past the end.
+        ct_set_word_t start_bit = bit_within_word(start_ct.id);
+        ct_set_word_t above_start = ~(start_bit | (start_bit - 1));
+        return first_ct_from_word(set, idx_of_word(start_ct.id), above_start);
 }
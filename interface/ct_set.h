@@ -5,15 +5,39 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "../interface/ct.h"
-#include "../tools/byte.h"
 
 #define CT_SET_FS "component type set%s"
 #define CT_SET_FA(ct_set) ""
 
+typedef uint64_t ct_set_word_t;
+
+#define CT_SET_WORD_BITS 64
+
+// The number of words stored in the set itself. Sets with component
+// type IDs below "CT_SET_INLINE_WORDS" * "CT_SET_WORD_BITS" allocate
+// nothing; only larger ones move their words to the heap.
+#define CT_SET_INLINE_WORDS 2
+
+// One bit for every component type ID, on iff the component type is in
+// the set. Component type "i" is bit "i" % "CT_SET_WORD_BITS" of word
+// "i" / "CT_SET_WORD_BITS", counting from the least significant bit.
+// A set with every member 0 is a valid empty set, same as one returned
+// by "create_ct_set".
 struct CtSet {
-        size_t size;
-        byte_t * contents;
+        // The number of words in the set. The last word is never 0, so
+        // there are no more words than needed.
+        size_t word_count;
+        // The number of words allocated on the heap, if "word_count" is
+        // larger than "CT_SET_INLINE_WORDS"; unused otherwise.
+        size_t word_capacity;
+        // "inline_words" if "word_count" <= "CT_SET_INLINE_WORDS",
+        // "heap_words" otherwise.
+        union {
+                ct_set_word_t inline_words[CT_SET_INLINE_WORDS];
+                ct_set_word_t * heap_words;
+        };
 };
 
 // Creates a new component type set with no component types.
@@ -32,6 +56,10 @@ void copy_ct_set(struct CtSet * dest, const struct CtSet * src);
 // that are either in "set1" or "set2".
 struct CtSet ct_set_union(const struct CtSet * set1, const struct CtSet * set2);
 
+// Creates a new set that contains all component types
+// that are in "set1" but not in "set2".
+struct CtSet ct_set_difference(const struct CtSet * set1, const struct CtSet * set2);
+
 // Returns "true" if "set" contains "ct", "false" otherwise.
 bool ct_in_set(const struct CtSet * set, struct Ct ct);
 
@@ -48,12 +76,21 @@ bool ct_set_in_set(const struct CtSet * subset, const struct CtSet * superset);
 // Passing two pointers to the same set is valid.
 bool ct_sets_equal(const struct CtSet * set1, const struct CtSet * set2);
 
+// Returns "true" if at least one component type is in both "set1" and
+// "set2", "false" otherwise.
+// Passing two pointers to the same set is valid.
+bool ct_sets_intersect(const struct CtSet * set1, const struct CtSet * set2);
+
 // Returns "true" iff "set" contains no components.
 bool ct_set_empty(const struct CtSet * set);
 
 // The number of component types in "set".
 size_t cts_in_set_count(const struct CtSet * set);
 
+// A hash of the component types in "set". Equal sets have equal hashes,
+// however they were built.
+uint64_t ct_set_hash(const struct CtSet * set);
+
 // Adds "ct" to "set", which cannot already contain "ct".
 void add_ct_to_set(struct CtSet * set, struct Ct ct);
 
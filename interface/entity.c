@@ -1,4 +1,5 @@
 #include "entity.h"
+#include <stdlib.h>
 #include "../globals/id_mgrs.h"
 #include "../tools/mem_tools.h"
 #include "../tools/log.h"
@@ -6,7 +7,13 @@
 #include "ct_set.h"
 #include "../structs/arct.h"
 #include "../structs/entity_data.h"
+#include "../structs/entity_gens.h"
 #include "../structs/arct_data.h"
+#include "../structs/sys_schedule.h"
+#include "../structs/deferred_cmds.h"
+#include "cmd_buf.h"
+
+#define MEM_TAG MEM_TAG_ENTITY
 
 #define CHECK_ENTITY_EXISTENCE(entity, err_return_val) \
         ASSERT_OR_HANDLE(entity_exists(entity), err_return_val, \
@@ -21,12 +28,25 @@ static bool ct_exists(struct Ct ct)
         ASSERT_OR_HANDLE(ct_exists(ct), err_return_val, \
                 "Non-existent " CT_FS ".", CT_FA(ct));
 
+// Entities are moved between tables that other threads may be reading
+// while systems run on several threads. Threads running systems always
+// defer their changes, so this only fails on other threads.
+#define CHECK_NOT_PARALLEL() \
+        ASSERT(!sys_schedule_running(), \
+                "Cannot change entities while systems run on several threads.")
+
 struct Entity create_entity(void)
 {
+        // Systems may be reading the table of the new entity.
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                return cmd_create_entity(cmd_buf);
+        }
+
         LOG_DEBUG("Creating entity ...\n");
-        struct Entity entity = {
-                .id = generate_id_of_type(ID_MGR_ENTITIES)
-        };
+        CHECK_NOT_PARALLEL();
+
+        struct Entity entity = entity_of_id(generate_id_of_type(ID_MGR_ENTITIES));
 
         // Create an empty "struct CtSet" (entities are initialized with
         // no components), and find an archetype matching that empty set,
@@ -35,14 +55,9 @@ struct Entity create_entity(void)
         struct Arct arct = create_arct(&ct_set);
         destroy_ct_set(&ct_set);
 
-        // Create underlying data for this entity and add it to the map
-        // of all entities.
-        struct EntityData entity_data = create_entity_data(arct);
-        add_to_map(&g_entity_map, entity.id, &entity_data);
-
-        // Add this entity to the "struct CTable" of its archetype.
-        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
-        add_entity_to_table(&arct_data->ctable, entity);
+        // Create underlying data for this entity and add it to the
+        // "struct CTable" of its archetype.
+        add_entity_to_arct(entity, arct);
 
         LOG_INFO("Created " ENTITY_FS ".\n", ENTITY_FA(entity));
         LOG_DEBUG_HIDE_LEVEL("\n");
@@ -50,42 +65,90 @@ struct Entity create_entity(void)
         return entity;
 }
 
+void create_entities(size_t count, const struct CtSet * ct_set, struct Entity * entities)
+{
+        // Same as in "create_entity", the new entities may belong to
+        // tables that are being read.
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                for (size_t i = 0; i < count; ++i) {
+                        entities[i] = cmd_create_entity(cmd_buf);
+
+                        struct Ct ct = first_ct_in_set(ct_set);
+                        while (ct.id != PCECS_INVALID_ID) {
+                                cmd_add_component(cmd_buf, entities[i], ct, NULL);
+                                ct = next_ct_in_set(ct_set, ct);
+                        }
+                }
+                return;
+        }
+
+        LOG_DEBUG("Creating %d entities from " CT_SET_FS " ...\n", (int) count, CT_SET_FA(*ct_set));
+        CHECK_NOT_PARALLEL();
+
+        struct Ct ct = first_ct_in_set(ct_set);
+        while (ct.id != PCECS_INVALID_ID) {
+                CHECK_CT_EXISTENCE(ct, );
+                ct = next_ct_in_set(ct_set, ct);
+        }
+
+        if (count == 0) {
+                return;
+        }
+
+        pcecs_id_t * ids = ALLOC(pcecs_id_t, count);
+        generate_ids_of_type(ID_MGR_ENTITIES, ids, count);
+        for (size_t i = 0; i < count; ++i) {
+                entities[i] = entity_of_id(ids[i]);
+        }
+        FREE(ids);
+
+        struct Arct arct = create_arct(ct_set);
+        size_t first_row = add_entities_to_arct(entities, count, arct);
+
+        struct Arct no_arct = {
+                .id = PCECS_INVALID_ID
+        };
+        start_arct_rows(arct, no_arct, first_row, count);
+
+        LOG_INFO("Created %d entities.\n", (int) count);
+        LOG_DEBUG_HIDE_LEVEL("\n");
+}
+
 static bool entity_exists(struct Entity entity)
 {
-        return map_contains(&g_entity_map, entity.id);
+        return entity_gen_alive(entity);
 }
 
 void destroy_entity(struct Entity * entity)
 {
+        // Entities created by the deferred commands don't exist yet, so
+        // this is done before checking their existence.
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                cmd_destroy_entity(cmd_buf, *entity);
+                return;
+        }
+
         // Return nothing if it doesn't exist.
         CHECK_ENTITY_EXISTENCE(*entity, );
+        CHECK_NOT_PARALLEL();
 
         LOG_INFO("Destroying " ENTITY_FS " ...\n", ENTITY_FA(*entity));
 
-        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity->id);
-        struct ArctData * arct_data;
-        arct_data = get_map_element(&g_arct_map, entity_data->arct.id);
-
-        // Call the "SYS_DESTROY" functions of all systems affecting "entity".
-        struct CGroup cgroup;
-        cgroup.entity = *entity;
-        for (size_t i = 0; i < arct_data->systems.len; ++i) {
-
-                cgroup.sys.id = arct_data->systems.contents[i];
-                sys_func_t sys_destructor = get_sys_func(cgroup.sys, SYS_DESTROY);
-                sys_destructor(cgroup);
-        }
-
         // Erase everyone's memory of "entity" so they forger.
-        struct CTable * table = &arct_data->ctable;
-        destroy_table_entity(table, *entity);
-        remove_from_map(&g_entity_map, entity->id);
+        remove_entity_from_arct(*entity);
         destroy_id_of_type(ID_MGR_ENTITIES, entity->id);
 }
 
 bool entities_equal(struct Entity entity1, struct Entity entity2)
 {
-        return entity1.id == entity2.id;
+        return entity1.id == entity2.id && entity1.generation == entity2.generation;
+}
+
+bool entity_alive(struct Entity entity)
+{
+        return entity_gen_alive(entity);
 }
 
 bool contains_component(struct Entity entity, struct Ct ct)
@@ -108,7 +171,7 @@ bool contains_component(struct Entity entity, struct Ct ct)
 
 static void add_or_remove_component(struct Entity entity, struct Ct ct, bool add)
 {
-        struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
 
         struct Arct arct = entity_data->arct;
         struct ArctData * archetype_data = get_map_element(&g_arct_map, arct.id);
@@ -128,46 +191,25 @@ static void add_or_remove_component(struct Entity entity, struct Ct ct, bool add
         // matches this entity.
         struct Arct new_arct = (*edge_accessor)(&archetype_data->edges, ct);
 
-        struct ArctData * new_arct_data;
-        new_arct_data = get_map_element(&g_arct_map, new_arct.id);
-        struct CTable * new_ctable = &new_arct_data->ctable;
-
-        // "edge_accessor" may have created a new archetype, possibly
-        // invalidating "archetype_data".
-        // Therefore, we must reassign it.
-        archetype_data = get_map_element(&g_arct_map, arct.id);
-        struct CTable * ctable = &archetype_data->ctable;
-
         // Move this entity to the component table of the new archetype.
-        entity_data->arct = new_arct;
-        move_entity(new_ctable, ctable, entity);
+        move_entity_to_arct(entity, new_arct);
 }
 
-static void call_start_functions(
-        const struct IdPool * systems,
-        const struct IdPool * excluded_systems,
-        struct Entity entity)
+void add_component(struct Entity entity, struct Ct ct)
 {
-        struct CGroup cgroup;
-        cgroup.entity = entity;
-        for (size_t i = 0; i < systems->len; ++i) {
-                struct Sys sys;
-                sys.id = systems->contents[i];
-
-                if (!id_in_pool(excluded_systems, sys.id)) {
-                        cgroup.sys = sys;
-                        sys_func_t start_func = get_sys_func(sys, SYS_START);
+        CHECK_CT_EXISTENCE(ct, );
 
-                        start_func(cgroup);
-                }
+        // "entity" may not exist yet if it's created by the deferred
+        // commands, and may have "ct" by then.
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                cmd_add_component(cmd_buf, entity, ct, NULL);
+                return;
         }
-}
 
-void add_component(struct Entity entity, struct Ct ct)
-{
         // Return nothing if they don't exist.
         CHECK_ENTITY_EXISTENCE(entity, );
-        CHECK_CT_EXISTENCE(ct, );
+        CHECK_NOT_PARALLEL();
 
         // Return nothing if condition is false.
         ASSERT_OR_HANDLE(!contains_component(entity, ct), , "Already " CT_FS " in " ENTITY_FS ".",
@@ -182,26 +224,27 @@ void add_component(struct Entity entity, struct Ct ct)
         // Call "add_or_remove_component" in addition mode.
         add_or_remove_component(entity, ct, true);
 
-        // The archetype map may have been moved after "add_or_remove_component",
-        // so "old_arct_data" cannot be found before after that function has
-        // been called.
-        const struct ArctData * old_arct_data = get_map_element(&g_arct_map, old_arct.id);
-
-        struct Arct new_arct = entity_data->arct;
-        const struct ArctData * new_arct_data = get_map_element(&g_arct_map, new_arct.id);
-
-        call_start_functions(&new_arct_data->systems, &old_arct_data->systems, entity);
+        start_entity_systems(entity, old_arct);
 
         LOG_DEBUG_HIDE_LEVEL("\n");
 }
 
 void remove_component(struct Entity entity, struct Ct ct)
 {
+        CHECK_CT_EXISTENCE(ct, );
+
+        // Same as in "add_component".
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                cmd_remove_component(cmd_buf, entity, ct);
+                return;
+        }
+
         // Return nothing if they don't exist.
         // Return nothing if they don't exist.
         // Return nothing if they don't exist.
         CHECK_ENTITY_EXISTENCE(entity, );
-        CHECK_CT_EXISTENCE(ct, );
+        CHECK_NOT_PARALLEL();
 
         // Return nothing if condition is false.
         ASSERT_OR_HANDLE(contains_component(entity, ct), , "No " CT_FS " in " ENTITY_FS ".",
@@ -214,6 +257,444 @@ void remove_component(struct Entity entity, struct Ct ct)
         add_or_remove_component(entity, ct, false);
 }
 
+// Same as "add_or_remove_component" for every component type of "cts"
+// at once.
+static void add_or_remove_components(struct Entity entity, const struct CtSet * cts, bool add)
+{
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+
+        struct Arct arct = entity_data->arct;
+        struct ArctData * archetype_data = get_map_element(&g_arct_map, arct.id);
+
+        struct Arct (* edge_accessor)(struct ArctEdges *, const struct CtSet *);
+        edge_accessor = add ? get_edge_with_cts : get_edge_without_cts;
+
+        struct Arct new_arct = (*edge_accessor)(&archetype_data->edges, cts);
+        if (!arcts_equal(new_arct, arct)) {
+                move_entity_to_arct(entity, new_arct);
+        }
+}
+
+static bool cts_exist(const struct CtSet * cts)
+{
+        struct Ct ct = first_ct_in_set(cts);
+        while (ct.id != PCECS_INVALID_ID) {
+                CHECK_CT_EXISTENCE(ct, false);
+                ct = next_ct_in_set(cts, ct);
+        }
+        return true;
+}
+
+// The component types of the archetype of "entity".
+static const struct CtSet * entity_ct_set(struct Entity entity)
+{
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, entity_data->arct.id);
+        return &arct_data->ct_set;
+}
+
+void add_components(struct Entity entity, const struct CtSet * cts)
+{
+        if (!cts_exist(cts)) {
+                return;
+        }
+
+        // Same as in "add_component".
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                struct Ct ct = first_ct_in_set(cts);
+                while (ct.id != PCECS_INVALID_ID) {
+                        cmd_add_component(cmd_buf, entity, ct, NULL);
+                        ct = next_ct_in_set(cts, ct);
+                }
+                return;
+        }
+
+        CHECK_ENTITY_EXISTENCE(entity, );
+        CHECK_NOT_PARALLEL();
+
+        ASSERT_OR_HANDLE(!ct_sets_intersect(entity_ct_set(entity), cts), ,
+                "Already some of " CT_SET_FS " in " ENTITY_FS ".", CT_SET_FA(cts), ENTITY_FA(entity));
+
+        LOG_INFO("Adding " CT_SET_FS " to " ENTITY_FS " ...\n",
+                CT_SET_FA(cts), ENTITY_FA(entity));
+
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        struct Arct old_arct = entity_data->arct;
+
+        add_or_remove_components(entity, cts, true);
+
+        start_entity_systems(entity, old_arct);
+
+        LOG_DEBUG_HIDE_LEVEL("\n");
+}
+
+void remove_components(struct Entity entity, const struct CtSet * cts)
+{
+        if (!cts_exist(cts)) {
+                return;
+        }
+
+        // Same as in "add_component".
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                struct Ct ct = first_ct_in_set(cts);
+                while (ct.id != PCECS_INVALID_ID) {
+                        cmd_remove_component(cmd_buf, entity, ct);
+                        ct = next_ct_in_set(cts, ct);
+                }
+                return;
+        }
+
+        CHECK_ENTITY_EXISTENCE(entity, );
+        CHECK_NOT_PARALLEL();
+
+        ASSERT_OR_HANDLE(ct_set_in_set(cts, entity_ct_set(entity)), ,
+                "Not all of " CT_SET_FS " in " ENTITY_FS ".", CT_SET_FA(cts), ENTITY_FA(entity));
+
+        LOG_INFO("Removing " CT_SET_FS " from " ENTITY_FS " ...\n",
+                CT_SET_FA(cts), ENTITY_FA(entity));
+
+        add_or_remove_components(entity, cts, false);
+}
+
+// Where an entity given to one of the batch functions is.
+struct EntityLocation {
+        struct Arct arct;
+        row_idx_t row;
+};
+
+// Sorts by archetype, and by descending row within an archetype.
+static int compare_entity_locations(const void * location1_ptr, const void * location2_ptr)
+{
+        const struct EntityLocation * location1 = location1_ptr;
+        const struct EntityLocation * location2 = location2_ptr;
+
+        if (location1->arct.id != location2->arct.id) {
+                return location1->arct.id < location2->arct.id ? -1 : 1;
+        }
+        if (location1->row != location2->row) {
+                return location1->row > location2->row ? -1 : 1;
+        }
+        return 0;
+}
+
+// Returns the locations of the "count" entities of "entities", sorted
+// with "compare_entity_locations".
+static struct EntityLocation * create_entity_locations(const struct Entity * entities, size_t count)
+{
+        struct EntityLocation * locations = ALLOC(struct EntityLocation, count);
+        for (size_t i = 0; i < count; ++i) {
+                const struct EntityData * entity_data = get_map_element(&g_entity_map, entities[i].id);
+                locations[i] = (struct EntityLocation) {
+                        .arct = entity_data->arct,
+                        .row = entity_data->row
+                };
+        }
+        qsort(locations, count, sizeof(struct EntityLocation), compare_entity_locations);
+
+        return locations;
+}
+
+// Returns the number of the first "count" locations of "locations" that
+// are in the same archetype as the first one.
+static size_t location_group_size(const struct EntityLocation * locations, size_t count)
+{
+        size_t group_size = 1;
+        while (group_size < count && arcts_equal(locations[group_size].arct, locations[0].arct)) {
+                ASSERT(locations[group_size].row != locations[group_size - 1].row,
+                        "Entity given twice to a batch.");
+                ++group_size;
+        }
+        return group_size;
+}
+
+// Returns the number of the first "count" locations of "locations",
+// which must be in the same archetype, whose rows follow right below
+// the first one.
+static size_t location_run_length(const struct EntityLocation * locations, size_t count)
+{
+        size_t run_length = 1;
+        while (run_length < count && locations[run_length].row + run_length == locations[0].row) {
+                ++run_length;
+        }
+        return run_length;
+}
+
+// Moves the entities located at "locations", which must all be in "arct"
+// and sorted by descending row, to "new_arct".
+// Moving the highest rows first means the rows filling the holes left
+// in the table of "arct" are never ones that are still to be moved, so
+// the rest of "locations" stays valid.
+static void move_located_entities(
+        const struct EntityLocation * locations,
+        size_t count,
+        struct Arct arct,
+        struct Arct new_arct,
+        bool add)
+{
+        size_t first_new_row = 0;
+        size_t run_start = 0;
+        while (run_start < count) {
+                size_t run_length = location_run_length(locations + run_start, count - run_start);
+
+                row_idx_t first_row = locations[run_start + run_length - 1].row;
+                size_t new_row = move_arct_rows(new_arct, arct, first_row, run_length);
+
+                // The moved entities end up next to each other at the end
+                // of the table of "new_arct".
+                if (run_start == 0) {
+                        first_new_row = new_row;
+                }
+                run_start += run_length;
+        }
+
+        // Only adding components can make systems affect the entities.
+        if (add) {
+                start_arct_rows(new_arct, arct, first_new_row, count);
+        }
+}
+
+static void add_or_remove_component_batch(const struct Entity * entities, size_t count, struct Ct ct, bool add)
+{
+        // Same as in "create_entities".
+        if (count == 0) {
+                return;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+                CHECK_ENTITY_EXISTENCE(entities[i], );
+                ASSERT_OR_HANDLE(contains_component(entities[i], ct) != add, ,
+                        "%s " CT_FS " in " ENTITY_FS ".", add ? "Already" : "No",
+                        CT_FA(ct), ENTITY_FA(entities[i]));
+        }
+
+        struct EntityLocation * locations = create_entity_locations(entities, count);
+
+        // The start functions mustn't move the entities that are still to
+        // be moved.
+        begin_deferring_cmds();
+
+        size_t group_start = 0;
+        while (group_start < count) {
+                struct Arct arct = locations[group_start].arct;
+                size_t group_size = location_group_size(locations + group_start, count - group_start);
+
+                // Same as in "add_or_remove_component".
+                struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+                struct Arct (* edge_accessor)(struct ArctEdges *, struct Ct);
+                edge_accessor = add ? get_edge_with_ct : get_edge_without_ct;
+                struct Arct new_arct = (*edge_accessor)(&arct_data->edges, ct);
+
+                move_located_entities(locations + group_start, group_size, arct, new_arct, add);
+                group_start += group_size;
+        }
+
+        end_deferring_cmds();
+        FREE(locations);
+}
+
+void add_component_batch(const struct Entity * entities, size_t count, struct Ct ct)
+{
+        CHECK_CT_EXISTENCE(ct, );
+
+        // Same as in "add_component".
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                for (size_t i = 0; i < count; ++i) {
+                        cmd_add_component(cmd_buf, entities[i], ct, NULL);
+                }
+                return;
+        }
+
+        CHECK_NOT_PARALLEL();
+
+        LOG_INFO("Adding " CT_FS " to %d entities ...\n", CT_FA(ct), (int) count);
+
+        add_or_remove_component_batch(entities, count, ct, true);
+
+        LOG_DEBUG_HIDE_LEVEL("\n");
+}
+
+void remove_component_batch(const struct Entity * entities, size_t count, struct Ct ct)
+{
+        CHECK_CT_EXISTENCE(ct, );
+
+        // Same as in "add_component".
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                for (size_t i = 0; i < count; ++i) {
+                        cmd_remove_component(cmd_buf, entities[i], ct);
+                }
+                return;
+        }
+
+        CHECK_NOT_PARALLEL();
+
+        LOG_INFO("Removing " CT_FS " from %d entities ...\n", CT_FA(ct), (int) count);
+
+        add_or_remove_component_batch(entities, count, ct, false);
+
+        LOG_DEBUG_HIDE_LEVEL("\n");
+}
+
+static void add_or_remove_component_in_arct(const struct CtSet * ct_set, struct Ct ct, bool add)
+{
+        CHECK_CT_EXISTENCE(ct, );
+
+        ASSERT_OR_HANDLE(ct_in_set(ct_set, ct) != add, , "%s " CT_FS " in " CT_SET_FS ".",
+                add ? "Already" : "No", CT_FA(ct), CT_SET_FA(*ct_set));
+
+        // Without an archetype, there are no entities to change.
+        struct Arct arct = find_arct(ct_set);
+        if (arct.id == PCECS_INVALID_ID) {
+                return;
+        }
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+        // The entities in the archetype right now are the ones changed
+        // once the commands are applied.
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                for (row_idx_t row = 0; row < arct_data->ctable.row_count; ++row) {
+                        struct Entity entity = arct_data->ctable.row_idx_to_entity[row];
+                        if (add) {
+                                cmd_add_component(cmd_buf, entity, ct, NULL);
+                        } else {
+                                cmd_remove_component(cmd_buf, entity, ct);
+                        }
+                }
+                return;
+        }
+
+        CHECK_NOT_PARALLEL();
+
+        size_t row_count = arct_data->ctable.row_count;
+        if (row_count == 0) {
+                return;
+        }
+
+        LOG_INFO("%s " CT_FS " %s %d entities of " ARCT_FS " ...\n", add ? "Adding" : "Removing",
+                CT_FA(ct), add ? "to" : "from", (int) row_count, ARCT_FA(arct));
+
+        // Same as in "add_or_remove_component".
+        struct Arct (* edge_accessor)(struct ArctEdges *, struct Ct);
+        edge_accessor = add ? get_edge_with_ct : get_edge_without_ct;
+        struct Arct new_arct = (*edge_accessor)(&arct_data->edges, ct);
+
+        // The whole table is moved at once.
+        begin_deferring_cmds();
+        size_t first_new_row = move_arct_rows(new_arct, arct, 0, row_count);
+        if (add) {
+                start_arct_rows(new_arct, arct, first_new_row, row_count);
+        }
+        end_deferring_cmds();
+
+        LOG_DEBUG_HIDE_LEVEL("\n");
+}
+
+void add_component_to_archetype(const struct CtSet * ct_set, struct Ct ct)
+{
+        add_or_remove_component_in_arct(ct_set, ct, true);
+}
+
+void remove_component_from_archetype(const struct CtSet * ct_set, struct Ct ct)
+{
+        add_or_remove_component_in_arct(ct_set, ct, false);
+}
+
+void destroy_entities(const struct Entity * entities, size_t count)
+{
+        // Same as in "destroy_entity".
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                for (size_t i = 0; i < count; ++i) {
+                        cmd_destroy_entity(cmd_buf, entities[i]);
+                }
+                return;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+                CHECK_ENTITY_EXISTENCE(entities[i], );
+        }
+        CHECK_NOT_PARALLEL();
+
+        // Same as in "create_entities".
+        if (count == 0) {
+                return;
+        }
+
+        LOG_INFO("Destroying %d entities ...\n", (int) count);
+
+        struct EntityLocation * locations = create_entity_locations(entities, count);
+
+        // Same as in "add_or_remove_component_batch", but for the destroy
+        // functions.
+        begin_deferring_cmds();
+
+        // Removing the highest rows first keeps the other locations valid
+        // (see "move_located_entities").
+        size_t run_start = 0;
+        while (run_start < count) {
+                size_t group_size = location_group_size(locations + run_start, count - run_start);
+                size_t run_length = location_run_length(locations + run_start, group_size);
+
+                row_idx_t first_row = locations[run_start + run_length - 1].row;
+                remove_arct_rows(locations[run_start].arct, first_row, run_length);
+
+                run_start += run_length;
+        }
+
+        end_deferring_cmds();
+        FREE(locations);
+
+        pcecs_id_t * ids = ALLOC(pcecs_id_t, count);
+        for (size_t i = 0; i < count; ++i) {
+                ids[i] = entities[i].id;
+        }
+        destroy_ids_of_type(ID_MGR_ENTITIES, ids, count);
+        FREE(ids);
+
+        LOG_DEBUG_HIDE_LEVEL("\n");
+}
+
+void clear_archetype(const struct CtSet * ct_set)
+{
+        // Without an archetype, there are no entities to destroy.
+        struct Arct arct = find_arct(ct_set);
+        if (arct.id == PCECS_INVALID_ID) {
+                return;
+        }
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+        // Same as in "add_or_remove_component_in_arct".
+        struct CmdBuf * cmd_buf = deferred_cmd_buf();
+        if (cmd_buf != NULL) {
+                for (row_idx_t row = 0; row < arct_data->ctable.row_count; ++row) {
+                        cmd_destroy_entity(cmd_buf, arct_data->ctable.row_idx_to_entity[row]);
+                }
+                return;
+        }
+
+        CHECK_NOT_PARALLEL();
+
+        size_t row_count = arct_data->ctable.row_count;
+        LOG_INFO("Destroying %d entities of " ARCT_FS " ...\n", (int) row_count, ARCT_FA(arct));
+
+        // The IDs are taken before the table forgets them.
+        pcecs_id_t * ids = ALLOC(pcecs_id_t, row_count);
+        for (size_t i = 0; i < row_count; ++i) {
+                ids[i] = arct_data->ctable.row_idx_to_entity[i].id;
+        }
+
+        clear_arct(arct);
+
+        destroy_ids_of_type(ID_MGR_ENTITIES, ids, row_count);
+        FREE(ids);
+
+        LOG_DEBUG_HIDE_LEVEL("\n");
+}
+
 void * get_component_from_entity(struct Entity entity, struct Ct ct)
 {
         CHECK_ENTITY_EXISTENCE(entity, NULL);
@@ -229,5 +710,5 @@ void * get_component_from_entity(struct Entity entity, struct Ct ct)
         const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
         const struct ArctData * arct_data;
         arct_data = get_map_element(&g_arct_map, entity_data->arct.id);
-        return get_table_component(&arct_data->ctable, entity, ct);
+        return get_table_component(&arct_data->ctable, entity_data->row, ct);
 }
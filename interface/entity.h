@@ -9,36 +9,128 @@
 #define ENTITY_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "ct.h"
+#include "ct_set.h"
 #include "../ids/id.h"
 
-#define ENTITY_FS "entity (" PCECS_ID_FS ")"
-#define ENTITY_FA(entity) PCECS_ID_FA((entity).id)
+#define ENTITY_FS "entity (" PCECS_ID_FS ", generation %" PRIU_OF_BITS(PCECS_ENTITY_GEN_BITS) ")"
+#define ENTITY_FA(entity) PCECS_ID_FA((entity).id), (entity_gen_t) (entity).generation
 
+// The width of the generations of entities, in bits (see "PCECS_ID_BITS").
+// One bit is used internally, so a handle may be mistaken for a new
+// entity with the same ID once the ID has been reused
+// 2^("PCECS_ENTITY_GEN_BITS" - 1) times.
+#ifndef PCECS_ENTITY_GEN_BITS
+#define PCECS_ENTITY_GEN_BITS 32
+#endif
+
+typedef UINT_OF_BITS(PCECS_ENTITY_GEN_BITS) entity_gen_t;
+
+// A handle to an entity. IDs of destroyed entities are reused by new
+// entities, but every reuse of an ID has a new "generation", so handles
+// to destroyed entities never refer to the entities that reuse their IDs
+// (see "entity_alive").
 struct Entity {
         pcecs_id_t id;
+        entity_gen_t generation;
 };
 
+// Entities created or destroyed by system functions, and entities whose
+// components are added or removed by them, are only changed once the
+// systems are done (see "cmd_buf.h"). Until then, the entities can't
+// be told apart from how they were before.
+
 // Create an entity and initialize all of its underlying data (not just
 // the structure itself).
 struct Entity create_entity(void);
 
+// Create "count" entities with the components in "ct_set", writing them
+// to "entities". The components will contain junk data.
+// This is much faster than creating the entities one at a time and
+// adding their components, since they're put straight into the
+// archetype of "ct_set", and its table only grows once. The start
+// functions of the systems affecting the entities are called once
+// they've all been created.
+void create_entities(size_t count, const struct CtSet * ct_set, struct Entity * entities);
+
 // Destroy an entity and all of its underlying data (not just the struct).
 void destroy_entity(struct Entity * entity);
 
+// Destroy the "count" entities of "entities", none of which may appear
+// twice.
+// This is much faster than calling "destroy_entity" on every entity,
+// since the entities of the same archetype are destroyed together, and
+// the components of entities in consecutive rows of their table are
+// destroyed one column at a time. Columns of component types without
+// a destructor are skipped entirely.
+void destroy_entities(const struct Entity * entities, size_t count);
+
+// Destroy every entity with exactly the components in "ct_set", the
+// same way as "destroy_entities". The storage of the entities is kept
+// for the next entities with those components.
+// When called by a system function, the entities with those components
+// at the time of the call are destroyed once the systems are done.
+void clear_archetype(const struct CtSet * ct_set);
+
 // Check if "entity1" and "entity2" are the same object.
 bool entities_equal(struct Entity entity1, struct Entity entity2);
 
+// Returns "true" iff "entity" is created and not yet destroyed. Handles
+// of destroyed entities stay dead even once their IDs are reused, so
+// they're safe to keep around and check later.
+// Entities created or destroyed by system functions are only alive or
+// dead once the systems are done, like other structural changes.
+bool entity_alive(struct Entity entity);
+
 // Check if "entity" contains "ct".
 bool contains_component(struct Entity entity, struct Ct ct);
 
 // Add "ct" to "entity". The new component will contain junk data, but can
 // be initialized using "get_component" or "get_component_from_entity".
+// System functions should use "cmd_add_component" on "get_sys_cmd_buf()"
+// with the value instead, since the component won't exist until the
+// systems are done.
 void add_component(struct Entity entity, struct Ct ct);
 
 // Remove "ct" from "entity".
 void remove_component(struct Entity entity, struct Ct ct);
 
+// Add every component type of "cts" to "entity", which can't contain any
+// of them yet. Same as calling "add_component" for each of them, except
+// "entity" is moved straight to its final archetype, so each of its
+// components is moved only once, and no archetype is created for the
+// component types in between.
+void add_components(struct Entity entity, const struct CtSet * cts);
+
+// Remove every component type of "cts" from "entity", which must contain
+// all of them. See "add_components".
+void remove_components(struct Entity entity, const struct CtSet * cts);
+
+// Add "ct" to each of the "count" entities of "entities", none of which
+// may already contain "ct" or appear twice.
+// This is much faster than calling "add_component" on every entity,
+// since the entities of the same archetype are moved together, and
+// entities in consecutive rows of their table are moved one column at
+// a time rather than one entity at a time.
+void add_component_batch(const struct Entity * entities, size_t count, struct Ct ct);
+
+// Remove "ct" from each of the "count" entities of "entities", all of
+// which must contain "ct" and appear only once. See "add_component_batch".
+void remove_component_batch(const struct Entity * entities, size_t count, struct Ct ct);
+
+// Add "ct" to every entity with exactly the components in "ct_set",
+// which can't contain "ct". The entities are moved to their new
+// archetype all at once, which is the fastest way to add a component to
+// a lot of entities.
+// When called by a system function, the entities with those components
+// at the time of the call are changed once the systems are done.
+void add_component_to_archetype(const struct CtSet * ct_set, struct Ct ct);
+
+// Remove "ct" from every entity with exactly the components in "ct_set",
+// which must contain "ct". See "add_component_to_archetype".
+void remove_component_from_archetype(const struct CtSet * ct_set, struct Ct ct);
+
 // Returns the component of type "ct" in "entity".
 // Cannot be called if "entity" doesn't contain "ct".
 // "get_component" is recommended over this one, as it's safer.
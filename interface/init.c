@@ -1,8 +1,23 @@
 #include <stdbool.h>
+#include "init.h"
 #include "../tools/log.h"
+#include "../tools/mem_tools.h"
 #include "../globals/id_mgrs.h"
 #include "../globals/maps.h"
 
+void init_pcecs_with_allocator(struct Allocator allocator)
+{
+        ASSERT_OR_HANDLE(allocator.alloc && allocator.realloc && allocator.free, ,
+                "Allocator is missing a function.");
+#if DEBUG_ON
+        // Memory must be freed by the allocator it's allocated by.
+        ASSERT_OR_HANDLE(MEM_IN_USE() == 0, , "Memory allocated before setting the allocator.");
+#endif
+
+        g_allocator = allocator;
+        init_pcecs();
+}
+
 void init_pcecs(void)
 {
         static bool s_initialized = false;
@@ -6,8 +6,14 @@
 #ifndef PCECS_INIT_H
 #define PCECS_INIT_H
 
+#include "allocator.h"
+
 // Does all initialization needed for pcecs.
 // Creates no entities, component types or systems.
 void init_pcecs(void);
 
+// Same as "init_pcecs", but everything pcecs allocates from now on is
+// allocated by "allocator" rather than with "malloc".
+void init_pcecs_with_allocator(struct Allocator allocator);
+
 #endif
@@ -0,0 +1,132 @@
+#include "mem_stats.h"
+#include "../tools/log.h"
+#include "../structs/map.h"
+#include "../structs/arct_data.h"
+#include "../structs/ct_data.h"
+#include "../structs/sys_data.h"
+#include "../structs/query.h"
+#include "../structs/entity_gens.h"
+#include "../structs/arct_index.h"
+#include "../ids/id_pool.h"
+#include "../globals/maps.h"
+#include "../globals/id_mgrs.h"
+
+static void add_mem_usage(struct PcecsMemUsage * dest, struct PcecsMemUsage usage)
+{
+        dest->used += usage.used;
+        dest->reserved += usage.reserved;
+}
+
+// Small sets are stored inline in whatever owns them, so only the
+// words of sets too large for that are counted.
+static struct PcecsMemUsage ct_set_mem_usage(const struct CtSet * set)
+{
+        if (set->word_count <= CT_SET_INLINE_WORDS) {
+                return (struct PcecsMemUsage) {0};
+        }
+        return (struct PcecsMemUsage) {
+                .used = set->word_count * sizeof(ct_set_word_t),
+                .reserved = set->word_capacity * sizeof(ct_set_word_t)
+        };
+}
+
+static void arcts_memory_report(struct PcecsMemStats * stats)
+{
+        const struct ArctData * arct_datas = g_arct_map.values;
+        for (map_idx_t i = 0; i < g_arct_map.length; ++i) {
+                const struct ArctData * arct_data = &arct_datas[i];
+
+                struct PcecsArctMemStats arct_stats;
+                arct_stats.ct_set = &arct_data->ct_set;
+                ctable_mem_usage(&arct_data->ctable, &arct_stats);
+                arct_stats.edges = arct_edges_mem_usage(&arct_data->edges);
+                arct_stats.systems = id_pool_mem_usage(&arct_data->systems);
+
+                add_mem_usage(&stats->columns, arct_stats.columns);
+                add_mem_usage(&stats->row_entities, arct_stats.row_entities);
+                add_mem_usage(&stats->column_maps, arct_stats.column_map);
+                add_mem_usage(&stats->edge_maps, arct_stats.edges);
+                add_mem_usage(&stats->id_pools, arct_stats.systems);
+                add_mem_usage(&stats->ct_sets, ct_set_mem_usage(&arct_data->ct_set));
+                for (size_t j = 0; j < arct_data->edges.transition_count; ++j) {
+                        add_mem_usage(&stats->ct_sets,
+                                ct_set_mem_usage(&arct_data->edges.transitions[j].delta));
+                }
+
+                if (i < stats->arcts_capacity) {
+                        stats->arcts[i] = arct_stats;
+                }
+        }
+        stats->arct_count = g_arct_map.length;
+}
+
+static void cts_memory_report(struct PcecsMemStats * stats)
+{
+        const struct CtData * ct_datas = g_ct_map.values;
+        for (map_idx_t i = 0; i < g_ct_map.length; ++i) {
+                add_mem_usage(&stats->id_pools, id_pool_mem_usage(&ct_datas[i].arcts));
+                add_mem_usage(&stats->id_pools, id_pool_mem_usage(&ct_datas[i].queries));
+        }
+}
+
+static void systems_memory_report(struct PcecsMemStats * stats)
+{
+        const struct SysData * sys_datas = g_sys_map.values;
+        for (map_idx_t i = 0; i < g_sys_map.length; ++i) {
+                add_mem_usage(&stats->ct_sets, ct_set_mem_usage(&sys_datas[i].reads));
+                add_mem_usage(&stats->ct_sets, ct_set_mem_usage(&sys_datas[i].writes));
+                add_mem_usage(&stats->ct_sets, ct_set_mem_usage(&sys_datas[i].requirements));
+        }
+}
+
+static void queries_memory_report(struct PcecsMemStats * stats)
+{
+        const struct QueryData * query_datas = g_query_map.values;
+        for (map_idx_t i = 0; i < g_query_map.length; ++i) {
+                add_mem_usage(&stats->id_pools, id_pool_mem_usage(&query_datas[i].arcts));
+                add_mem_usage(&stats->id_pools, id_pool_mem_usage(&query_datas[i].systems));
+                add_mem_usage(&stats->ct_sets, ct_set_mem_usage(&query_datas[i].requirements));
+        }
+}
+
+void pcecs_memory_report(struct PcecsMemStats * stats)
+{
+        LOG_DEBUG("Reporting the memory used by pcecs ...\n");
+
+        ASSERT_OR_HANDLE(stats->arcts || stats->arcts_capacity == 0, ,
+                "Cannot report the memory of %d archetypes to NULL.", (int) stats->arcts_capacity);
+
+        // Everything but the archetype list is written from scratch.
+        *stats = (struct PcecsMemStats) {
+                .arcts = stats->arcts,
+                .arcts_capacity = stats->arcts_capacity
+        };
+
+        stats->entity_map = map_mem_usage(&g_entity_map);
+        stats->ct_map = map_mem_usage(&g_ct_map);
+        stats->sys_map = map_mem_usage(&g_sys_map);
+        stats->arct_map = map_mem_usage(&g_arct_map);
+        stats->query_map = map_mem_usage(&g_query_map);
+        stats->entity_generations = entity_gens_mem_usage();
+        stats->arct_index = arct_index_mem_usage();
+
+        arcts_memory_report(stats);
+        cts_memory_report(stats);
+        systems_memory_report(stats);
+        queries_memory_report(stats);
+        add_mem_usage(&stats->id_pools, id_managers_mem_usage());
+
+        const struct PcecsMemUsage * parts[] = {
+                &stats->entity_map, &stats->ct_map, &stats->sys_map, &stats->arct_map,
+                &stats->query_map, &stats->entity_generations, &stats->arct_index, &stats->columns,
+                &stats->row_entities, &stats->column_maps, &stats->edge_maps, &stats->id_pools,
+                &stats->ct_sets
+        };
+        for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); ++i) {
+                add_mem_usage(&stats->total, *parts[i]);
+        }
+        stats->wasted = stats->total.reserved - stats->total.used;
+
+        LOG_DEBUG("Pcecs uses %d of %d allocated bytes.\n",
+                (int) stats->total.used, (int) stats->total.reserved);
+}
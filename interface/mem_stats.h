@@ -0,0 +1,86 @@
+// Reports where the memory allocated by pcecs goes. Works the same
+// regardless of "DEBUG_MODE", since it's computed from the data
+// structures themselves rather than from tracked allocations.
+
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <stddef.h>
+#include "ct_set.h"
+
+// Bytes "reserved" are allocated; bytes "used" hold live data. The
+// difference is capacity allocated ahead of time, or left over after
+// shrinking.
+struct PcecsMemUsage {
+        size_t used;
+        size_t reserved;
+};
+
+struct PcecsArctMemStats {
+        // The component types of the archetype. Owned by pcecs, and only
+        // valid until the next structural change.
+        const struct CtSet * ct_set;
+        size_t entity_count;
+        // The components of the entities, whether they're stored in
+        // columns or chunks (see "set_archetype_chunk_size").
+        struct PcecsMemUsage columns;
+        // The entity in each row of the table.
+        struct PcecsMemUsage row_entities;
+        // The map from component types to columns.
+        struct PcecsMemUsage column_map;
+        // The archetypes with one component type more or less, and with
+        // several more or less (see "add_components").
+        struct PcecsMemUsage edges;
+        // The systems affecting the archetype.
+        struct PcecsMemUsage systems;
+};
+
+struct PcecsMemStats {
+        // The global maps from IDs to underlying data, not counting the
+        // memory owned by the data, which is counted below.
+        struct PcecsMemUsage entity_map;
+        struct PcecsMemUsage ct_map;
+        struct PcecsMemUsage sys_map;
+        struct PcecsMemUsage arct_map;
+        struct PcecsMemUsage query_map;
+        // The generation of every entity ID (see "entity_alive").
+        struct PcecsMemUsage entity_generations;
+        // The index from component types to archetypes.
+        struct PcecsMemUsage arct_index;
+
+        // The sums of the "struct PcecsArctMemStats" of every archetype.
+        struct PcecsMemUsage columns;
+        struct PcecsMemUsage row_entities;
+        struct PcecsMemUsage column_maps;
+        struct PcecsMemUsage edge_maps;
+
+        // Every pool of IDs: the systems of archetypes, the archetypes and
+        // queries of component types, the archetypes and systems of
+        // queries, and the destroyed IDs waiting to be reused.
+        struct PcecsMemUsage id_pools;
+        // Every set of component types, of archetypes, systems, queries
+        // and archetype transitions.
+        struct PcecsMemUsage ct_sets;
+
+        // All of the above.
+        struct PcecsMemUsage total;
+        // "total.reserved" - "total.used".
+        size_t wasted;
+
+        // Set "arcts" to an array of "arcts_capacity" elements before
+        // calling "pcecs_memory_report" to get the stats of each archetype
+        // too. "arct_count" is set to the number of archetypes, and the
+        // first "arcts_capacity" of them are written to "arcts". "arcts"
+        // may be NULL if "arcts_capacity" is 0.
+        struct PcecsArctMemStats * arcts;
+        size_t arcts_capacity;
+        size_t arct_count;
+};
+
+// Fills "stats" with the memory currently used and reserved by pcecs,
+// except for "arcts" and "arcts_capacity", which are left as they are.
+// Takes time linear in the number of archetypes, component types,
+// systems and queries, but not in the number of entities.
+void pcecs_memory_report(struct PcecsMemStats * stats);
+
+#endif
@@ -0,0 +1,56 @@
+#include "storage.h"
+#include "../tools/log.h"
+#include "../structs/ctable.h"
+#include "../structs/arct.h"
+#include "../structs/arct_data.h"
+#include "../structs/sys_schedule.h"
+#include "../structs/deferred_cmds.h"
+#include "../globals/maps.h"
+
+// Resizing or destroying a table pulls its components out from under
+// the systems reading it.
+#define CHECK_NO_SYSTEMS_RUNNING(err_return_val) \
+        ASSERT_OR_HANDLE(!sys_schedule_running() && deferred_cmd_buf() == NULL, err_return_val, \
+                "Cannot change archetypes while systems are running.")
+
+void set_archetype_chunk_size(size_t chunk_size)
+{
+        LOG_INFO("Setting the chunk size of new archetypes to %d bytes.\n", (int) chunk_size);
+
+        set_ctable_chunk_size(chunk_size);
+}
+
+void reserve_archetype_rows(const struct CtSet * ct_set, size_t row_count)
+{
+        CHECK_NO_SYSTEMS_RUNNING();
+
+        LOG_INFO("Reserving %d rows for " CT_SET_FS " ...\n", (int) row_count, CT_SET_FA(*ct_set));
+
+        struct Arct arct = create_arct(ct_set);
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        reserve_ctable_rows(&arct_data->ctable, row_count);
+}
+
+void shrink_archetype_storage(void)
+{
+        CHECK_NO_SYSTEMS_RUNNING();
+
+        LOG_INFO("Shrinking the storage of every archetype ...\n");
+
+        struct ArctData * arct_datas = g_arct_map.values;
+        for (map_idx_t i = 0; i < g_arct_map.length; ++i) {
+                shrink_ctable(&arct_datas[i].ctable);
+        }
+}
+
+size_t destroy_empty_archetypes(size_t min_empty_calls)
+{
+        CHECK_NO_SYSTEMS_RUNNING(0);
+
+        LOG_INFO("Destroying archetypes empty for %d calls ...\n", (int) min_empty_calls + 1);
+
+        size_t destroyed_count = destroy_empty_arcts(min_empty_calls);
+
+        LOG_INFO("Destroyed %d archetypes.\n", (int) destroyed_count);
+        return destroyed_count;
+}
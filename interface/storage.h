@@ -0,0 +1,50 @@
+// Controls how the components of the entities in each archetype are
+// stored (see "struct CTable").
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stddef.h>
+#include "ct_set.h"
+
+// Makes archetypes created from now on store their components in chunks
+// of about "chunk_size" bytes, each holding the same entities of every
+// component type, rather than in one buffer per component type. 16 KiB
+// (16384) is a good size. A "chunk_size" of 0 goes back to one buffer
+// per component type, which is the default.
+// Chunked archetypes grow by allocating another chunk rather than
+// resizing every buffer, which avoids the pauses of copying large
+// archetypes, and keeps pointers to components valid until their
+// entity is destroyed or changes archetype. Batch functions get at most
+// one chunk per batch.
+void set_archetype_chunk_size(size_t chunk_size);
+
+// Makes room for at least "row_count" entities with exactly the
+// components in "ct_set", so that creating them doesn't need to resize
+// the storage of their archetype along the way. The archetype keeps
+// that room even when its entities are destroyed, until
+// "shrink_archetype_storage" is called.
+// Cannot be called while systems are running.
+void reserve_archetype_rows(const struct CtSet * ct_set, size_t row_count);
+
+// Frees the storage that archetypes aren't using, including the room
+// reserved by "reserve_archetype_rows", for instance between two levels
+// of a game.
+// Cannot be called while systems are running.
+void shrink_archetype_storage(void);
+
+// Destroys the archetypes that had no entities at this call and at the
+// "min_empty_calls" calls before it, freeing their storage and
+// forgetting them everywhere else, so that archetypes entities only
+// passed through don't pile up and slow down systems. Call it every
+// now and then, for instance once a second with a "min_empty_calls" of
+// 10, or with 0 between two levels of a game to destroy every empty
+// archetype at once.
+// The archetype with no component types is never destroyed, and neither
+// are archetypes with rows reserved by "reserve_archetype_rows" until
+// "shrink_archetype_storage" is called. Returns the number of
+// archetypes destroyed.
+// Cannot be called while systems are running.
+size_t destroy_empty_archetypes(size_t min_empty_calls);
+
+#endif
@@ -5,6 +5,9 @@
 #include "../globals/maps.h"
 #include "../structs/ct_data.h"
 #include "../structs/arct_data.h"
+#include "../structs/query.h"
+#include "../structs/sys_schedule.h"
+#include "../structs/deferred_cmds.h"
 
 static void call_start_on_arct(struct Sys sys, struct Arct arct)
 {
@@ -14,85 +17,117 @@ static void call_start_on_arct(struct Sys sys, struct Arct arct)
                 "Is a system being created while entities are updating?");
 
         sys_func_t start_func = get_sys_func(sys, SYS_START);
+        if (!start_func) {
+                return;
+        }
+
         struct CGroup cgroup;
         cgroup.sys = sys;
 
+        // The table can't change while it's iterated.
+        begin_deferring_cmds();
+
         struct Entity entity = first_entity_in_ctable(&arct_data->ctable);
         while (entity.id != PCECS_INVALID_ID) {
 
                 cgroup.entity = entity;
-                if (start_func) {
-                        start_func(cgroup);
-                }
+                start_func(cgroup);
 
+                // "start_func" may have created archetypes, moving the
+                // archetype map.
+                arct_data = get_map_element(&g_arct_map, arct.id);
                 entity = next_entity_in_ctable(&arct_data->ctable, entity);
         }
+
+        end_deferring_cmds();
 }
 
 static void add_sys_to_arcts(struct Sys sys)
 {
         const struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        struct Query query = sys_data->query;
+
+        // Archetypes created by start functions are added to the query
+        // and given "sys" by "create_arct", so only the archetypes that
+        // already match need to be visited here.
+        const struct QueryData * query_data = get_map_element(&g_query_map, query.id);
+        size_t arct_count = query_data->arcts.len;
+
+        for (size_t i = 0; i < arct_count; ++i) {
+                // Start functions may create queries and archetypes, moving
+                // both maps around.
+                query_data = get_map_element(&g_query_map, query.id);
 
-        // Completely arbitrary component type, simply used to narrow
-        // the search for archetypes down.
-        struct Ct ct = first_ct_in_set(&sys_data->requirements);
-        const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
-
-        // Archetypes only match "sys" if they include all of its
-        // required component types.
-        // This means that we can speed up the search for archetypes
-        // by only iterating through archetypes containing at least
-        // one specific but arbitrary required component.
-        for (size_t i = 0; i < ct_data->arcts.len; ++i) {
                 struct Arct arct;
-                arct.id = ct_data->arcts.contents[i];
+                arct.id = query_data->arcts.contents[i];
                 struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
 
-                if (ct_set_in_set(&sys_data->requirements, &arct_data->ct_set)) {
-                        add_to_id_pool(&arct_data->systems, sys.id);
-                        call_start_on_arct(sys, arct);
-                }
+                add_to_id_pool(&arct_data->systems, sys.id);
+                call_start_on_arct(sys, arct);
         }
 }
 
-struct Sys create_sys(const struct CtSet * requirements, sys_func_t start_func)
+struct Sys create_sys_with_access(
+        const struct CtSet * reads,
+        const struct CtSet * writes,
+        sys_func_t start_func)
 {
         LOG_DEBUG("Creating system ...\n");
 
-        ASSERT_OR_HANDLE(!ct_set_empty(requirements), (struct Sys) {.id = PCECS_INVALID_ID},
+        ASSERT_OR_HANDLE(!ct_set_empty(reads) || !ct_set_empty(writes),
+                (struct Sys) {.id = PCECS_INVALID_ID},
                 "Cannot create system with no requirements.");
 
+        ASSERT(!sys_schedule_running(), "Cannot create systems while systems run on several threads.");
+
         struct Sys sys = {
                 .id = generate_id_of_type(ID_MGR_SYS)
         };
 
         // Create underlying data for the system and add it
         // to the global system map. Duh-doy!
-        struct SysData sys_data = create_sys_data(requirements);
+        struct SysData sys_data = create_sys_data(reads, writes);
         add_to_map(&g_sys_map, sys.id, &sys_data);
 
+        // From now on, archetypes matching the query of "sys" are given
+        // "sys" as soon as they're created.
+        struct QueryData * query_data = get_map_element(&g_query_map, sys_data.query.id);
+        add_to_id_pool(&query_data->systems, sys.id);
+
         set_sys_func(sys, SYS_START, start_func);
 
         add_sys_to_arcts(sys);
+        invalidate_sys_schedule();
 
         LOG_INFO("Created " SYS_FS ".\n", SYS_FA(sys));
         LOG_DEBUG_HIDE_LEVEL("\n");
         return sys;
 }
 
+struct Sys create_sys(const struct CtSet * requirements, sys_func_t start_func)
+{
+        // Without knowing better, every required component type might be
+        // changed by the system.
+        struct CtSet reads = create_ct_set();
+        struct Sys sys = create_sys_with_access(&reads, requirements, start_func);
+        destroy_ct_set(&reads);
+
+        return sys;
+}
+
 static void remove_sys_from_arcts(struct Sys sys)
 {
-        struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        const struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        struct QueryData * query_data = get_map_element(&g_query_map, sys_data->query.id);
 
-        struct Ct ct = first_ct_in_set(&sys_data->requirements);
-        const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+        remove_from_id_pool(&query_data->systems, sys.id);
 
-        for (size_t i = 0; i < ct_data->arcts.len; ++i) {
-                struct Arct arct;
-                arct.id = ct_data->arcts.contents[i];
-                struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        // Every archetype affected by "sys" is in its query.
+        for (size_t i = 0; i < query_data->arcts.len; ++i) {
+                struct ArctData * arct_data;
+                arct_data = get_map_element(&g_arct_map, query_data->arcts.contents[i]);
 
-                if (id_pool_contains(&arct_data->systems, sys.id)) {
+                if (id_in_pool(&arct_data->systems, sys.id)) {
                         remove_from_id_pool(&arct_data->systems, sys.id);
                 }
         }
@@ -103,9 +138,12 @@ void destroy_sys(struct Sys * sys)
         ASSERT_OR_HANDLE(map_contains(&g_sys_map, sys->id), ,
                 "Cannot destroy non-existent " SYS_FS ".", SYS_FA(*sys));
 
+        ASSERT(!sys_schedule_running(), "Cannot destroy systems while systems run on several threads.");
+
         remove_sys_from_arcts(*sys);
+        invalidate_sys_schedule();
 
-        // TODO: code
+        remove_from_map(&g_sys_map, sys->id);
         destroy_id_of_type(ID_MGR_SYS, sys->id);
 }
 
@@ -116,21 +154,58 @@ bool sys_equal(struct Sys sys1, struct Sys sys2)
 
 static void exec_all_systems(enum SysFuncType func_type)
 {
-        // ENDELIG!
-        for (map_idx_t i = 0; i < g_arct_map.length; ++i) {
-                struct Arct arct;
-                arct.id = g_arct_map.index_to_id[i];
+        begin_deferring_cmds();
+
+        // Only the archetypes matching at least one system are visited,
+        // since every system belongs to a query caching its archetypes.
+        for (map_idx_t i = 0; i < g_query_map.length; ++i) {
+                pcecs_id_t query_id = g_query_map.index_to_id[i];
+                const struct QueryData * query_data = get_map_element(&g_query_map, query_id);
 
-                exec_arct_systems(arct, func_type);
+                for (size_t j = 0; j < query_data->arcts.len; ++j) {
+                        struct Arct arct;
+                        arct.id = query_data->arcts.contents[j];
+
+                        for (size_t k = 0; k < query_data->systems.len; ++k) {
+                                struct Sys sys;
+                                sys.id = query_data->systems.contents[k];
+
+                                exec_arct_system(arct, sys, func_type);
+
+                                // Systems may create queries, moving the
+                                // query map.
+                                query_data = get_map_element(&g_query_map, query_id);
+                        }
+                }
+        }
+
+        // The sync point: every change made by the systems is carried
+        // out here.
+        end_deferring_cmds();
+}
+
+void set_sys_thread_count(size_t thread_count)
+{
+        set_sys_schedule_thread_count(thread_count);
+}
+
+// Executes the functions of type "func_type" of every system, on
+// several threads if "set_sys_thread_count" says so.
+static void exec_systems(enum SysFuncType func_type)
+{
+        if (sys_schedule_thread_count() > 1) {
+                exec_sys_schedule(func_type);
+        } else {
+                exec_all_systems(func_type);
         }
 }
 
 void update_entities(void)
 {
-        exec_all_systems(SYS_UPDATE);
+        exec_systems(SYS_UPDATE);
 }
 
 void draw_entities(void)
 {
-        exec_all_systems(SYS_DRAW);
+        exec_systems(SYS_DRAW);
 }
@@ -15,6 +15,7 @@
 #ifndef PCECS_SYS_H
 #define PCECS_SYS_H
 
+#include <stddef.h>
 #include "../ids/id.h"
 #include "ct_set.h"
 
@@ -40,6 +41,19 @@ void destroy_sys(struct Sys * sys);
 // et cetera) are equal.
 bool sys_equal(struct Sys sys1, struct Sys sys2);
 
+// Sets the number of threads "update_entities" and "draw_entities"
+// run systems on. The default is 1, which runs every system on the
+// calling thread.
+// With more than 1 thread, systems that don't conflict (see
+// "create_sys_with_access") run at the same time, so system functions
+// may only read and write the components of their entities, and cannot
+// create or destroy systems. Entities can still be created and
+// destroyed, and components added and removed, since those changes are
+// recorded per thread and carried out once every system is done (see
+// "cmd_buf.h").
+// Cannot be called while entities are updating or drawing.
+void set_sys_thread_count(size_t thread_count);
+
 // Call all update functions on all entities!
 void update_entities(void);
 
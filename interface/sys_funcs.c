@@ -2,6 +2,7 @@
 #include "../globals/maps.h"
 #include "../structs/sys_data.h"
 #include "../tools/debug.h"
+#include "../structs/sys_schedule.h"
 
 static sys_func_t * get_sys_func_ptr(struct Sys sys, enum SysFuncType type)
 {
@@ -21,6 +22,23 @@ static sys_func_t * get_sys_func_ptr(struct Sys sys, enum SysFuncType type)
         return NULL;
 }
 
+static sys_batch_func_t * get_sys_batch_func_ptr(struct Sys sys, enum SysFuncType type)
+{
+        struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+
+        switch (type) {
+        case SYS_UPDATE:
+                return &sys_data->batch_funcs.update;
+        case SYS_DRAW:
+                return &sys_data->batch_funcs.draw;
+        case SYS_START:
+        case SYS_DESTROY:
+                break;
+        }
+        ASSERT(false, "Invalid system batch function %d.", (int) type);
+        return NULL;
+}
+
 static bool valid_sys_func_type(enum SysFuncType type)
 {
         switch (type) {
@@ -55,3 +73,59 @@ void set_sys_func(struct Sys sys, enum SysFuncType func_type, sys_func_t func)
         sys_func_t * old_func = get_sys_func_ptr(sys, func_type);
         *old_func = func;
 }
+
+static bool valid_sys_batch_func_type(enum SysFuncType type)
+{
+        switch (type) {
+        case SYS_UPDATE:
+        case SYS_DRAW:
+                return true;
+        case SYS_START:
+        case SYS_DESTROY:
+                break;
+        }
+        return false;
+}
+
+sys_batch_func_t get_sys_batch_func(struct Sys sys, enum SysFuncType type)
+{
+        ASSERT_OR_HANDLE(map_contains(&g_sys_map, sys.id), NULL,
+                "Non-existent " SYS_FS ".", SYS_FA(sys));
+
+        ASSERT_OR_HANDLE(valid_sys_batch_func_type(type), NULL,
+                "Invalid system batch function type %d.", (int) type);
+
+        return *get_sys_batch_func_ptr(sys, type);
+}
+
+void set_sys_batch_func(struct Sys sys, enum SysFuncType func_type, sys_batch_func_t func)
+{
+        ASSERT_OR_HANDLE(map_contains(&g_sys_map, sys.id), ,
+                "Non-existent " SYS_FS ".", SYS_FA(sys));
+
+        ASSERT_OR_HANDLE(valid_sys_batch_func_type(func_type), ,
+                "Invalid system batch function type %d.", (int) func_type);
+
+        sys_batch_func_t * old_func = get_sys_batch_func_ptr(sys, func_type);
+        *old_func = func;
+}
+
+void set_sys_batch_rows(struct Sys sys, size_t max_rows)
+{
+        ASSERT_OR_HANDLE(map_contains(&g_sys_map, sys.id), ,
+                "Non-existent " SYS_FS ".", SYS_FA(sys));
+
+        ASSERT(!sys_schedule_running(), "Cannot change batches while systems run on several threads.");
+
+        struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        sys_data->batch_rows = max_rows;
+}
+
+size_t get_sys_batch_rows(struct Sys sys)
+{
+        ASSERT_OR_HANDLE(map_contains(&g_sys_map, sys.id), 0,
+                "Non-existent " SYS_FS ".", SYS_FA(sys));
+
+        const struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        return sys_data->batch_rows;
+}
@@ -5,9 +5,13 @@
 
 #include "sys.h"
 #include "cgroup.h"
+#include "cbatch.h"
 
 typedef void (* sys_func_t)(struct CGroup);
 
+// Called once per archetype rather than once per entity; see "cbatch.h".
+typedef void (* sys_batch_func_t)(struct CBatch);
+
 // Systems have various functions affecting their entities.
 // "enum SysFuncType" is an enumeration representation of
 // the different types of system functions.
@@ -22,8 +26,24 @@ enum SysFuncType {
 // The start function is given as an argument since it's supposed to
 // be called at once when the system is created, so it kind of has to
 // exist when the system is created.
+// All required component types may be read and written by the system,
+// so it conflicts with every other system sharing any of them when
+// systems run on several threads (see "set_sys_thread_count").
 struct Sys create_sys(const struct CtSet * requirements, sys_func_t start_func);
 
+// Same as "create_sys", but the system only reads the components of
+// the types in "reads" and may only write the ones in "writes". The
+// requirements of the system are the union of the two sets.
+// Systems only reading the same component types can run at the same
+// time, while systems writing them can't run alongside any system
+// accessing them.
+// Components are read through "read_component" and written through
+// "get_component" (see "cgroup.h").
+struct Sys create_sys_with_access(
+        const struct CtSet * reads,
+        const struct CtSet * writes,
+        sys_func_t start_func);
+
 void destroy_sys(struct Sys * sys);
 
 // Get the function in 'sys' of type 'type', returning 'NULL' if
@@ -39,4 +59,32 @@ sys_func_t get_sys_func(struct Sys sys, enum SysFuncType type);
 // is illegal.
 void set_sys_func(struct Sys sys, enum SysFuncType func_type, sys_func_t func);
 
+// Get the batch function in "sys" of type "type", returning "NULL" if
+// it doesn't exist.
+// Only "SYS_UPDATE" and "SYS_DRAW" have batch functions, since the
+// other function types are called for single entities.
+sys_batch_func_t get_sys_batch_func(struct Sys sys, enum SysFuncType type);
+
+// Sets the batch function of type "func_type" in "sys" to "func", which
+// may be NULL. Same rules as "set_sys_func", except "func_type" must be
+// "SYS_UPDATE" or "SYS_DRAW".
+// A system may have both a normal function and a batch function of the
+// same type, in which case the normal function is called for each
+// entity of an archetype before the batch function is called for the
+// whole archetype.
+void set_sys_batch_func(struct Sys sys, enum SysFuncType func_type, sys_batch_func_t func);
+
+// Splits the archetypes of "sys" into batches of at most "max_rows"
+// rows, or hands out whole archetypes as batches if "max_rows" is 0,
+// which is the default.
+// When systems run on several threads (see "set_sys_thread_count"),
+// every batch is a separate job, so a single archetype with a huge
+// number of entities is spread over all the threads. Both the normal
+// functions and the batch functions of "sys" are split this way, but
+// the batches of one archetype are not called in any particular order.
+void set_sys_batch_rows(struct Sys sys, size_t max_rows);
+
+// The maximum number of rows set by "set_sys_batch_rows".
+size_t get_sys_batch_rows(struct Sys sys);
+
 #endif
@@ -1,4 +1,5 @@
 #include "arct.h"
+#include <stdlib.h>
 #include "../interface/ct_set.h"
 #include "../globals/id_mgrs.h"
 #include "arct_data.h"
@@ -6,64 +7,19 @@
 #include "../tools/log.h"
 #include "ct_data.h"
 #include "sys_data.h"
+#include "entity_data.h"
+#include "entity_gens.h"
+#include "query.h"
 #include "../interface/sys_funcs.h"
+#include "../tools/mem_tools.h"
+#include "deferred_cmds.h"
+#include "arct_index.h"
 
-// Returns an archetype with no component types if it exists,
-// or an archetype with id == "PCECS_INVALID_ID" if not.
-static struct Arct find_empty_arct(void)
-{
-        struct CtSet empty_ct_set = create_ct_set();
-
-        const struct ArctData * arct_datas = g_arct_map.values;
-
-        for (size_t i = 0; i < g_arct_map.length; ++i) {
-                if (ct_sets_equal(&arct_datas[i].ct_set, &empty_ct_set)) {
-
-                        pcecs_id_t arct_id = g_arct_map.index_to_id[i];
-
-                        destroy_ct_set(&empty_ct_set);
-                        return (struct Arct) {
-                                .id = arct_id
-                        };
-                }
-        }
-
-        destroy_ct_set(&empty_ct_set);
-        return (struct Arct) {
-                .id = PCECS_INVALID_ID
-        };
-}
+#define MEM_TAG MEM_TAG_ARCT
 
-// Returns an archetype with ID PCECS_INVALID_ID if the archetype isn't found.
-static struct Arct find_arct(const struct CtSet * ct_set)
+struct Arct find_arct(const struct CtSet * ct_set)
 {
-        // We're trying to narrow our search down to archetypes containing the
-        // first component type in "ct_set". If there is no first component
-        // type in "ct_set", however, we simply try to find an empty "CtSet".
-        struct Ct ct = first_ct_in_set(ct_set);
-        if (ct.id == PCECS_INVALID_ID) {
-                return find_empty_arct();
-        }
-
-        const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
-
-        // For each archetype containing the first component type in
-        // "ct_set" ...
-        for (size_t i = 0; i < ct_data->arcts.len; ++i) {
-                struct Arct arct;
-                arct.id = ct_data->arcts.contents[i];
-
-                const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
-
-                // Return the archetype if its "CtSet" matches "ct_set".
-                if (ct_sets_equal(&arct_data->ct_set, ct_set)) {
-                        return arct;
-                }
-        }
-
-        return (struct Arct) {
-                .id = PCECS_INVALID_ID
-        };
+        return find_indexed_arct(ct_set);
 }
 
 // If an archetype of the components in "ct_set" already exists,
@@ -86,6 +42,7 @@ struct Arct create_arct(const struct CtSet * ct_set)
         struct ArctData arct_data;
         arct_data = create_arct_data(new_arct, ct_set);
         add_to_map(&g_arct_map, new_arct.id, &arct_data);
+        add_arct_to_index(new_arct, &arct_data.ct_set);
 
         // Iterate through components in the created archetype.
         // For each component, add the archetype to its list of archetypes.
@@ -99,6 +56,10 @@ struct Arct create_arct(const struct CtSet * ct_set)
                 ct = next_ct_in_set(ct_set, ct);
         }
 
+        // Let the queries (and therefore the systems) matching the new
+        // archetype know about it.
+        add_arct_to_queries(new_arct);
+
         LOG_DEBUG("Created " ARCT_FS ".\n\n", ARCT_FA(new_arct));
         return new_arct;
 }
@@ -108,25 +69,382 @@ bool arcts_equal(struct Arct arct1, struct Arct arct2)
         return arct1.id == arct2.id;
 }
 
-static void exec_single_system(struct Arct arct, struct Sys sys, enum SysFuncType func_type)
+void add_entity_to_arct(struct Entity entity, struct Arct arct)
 {
-        sys_func_t sys_func = *get_sys_func(sys, func_type);
-        if (sys_func == NULL) {
+        struct EntityData entity_data = create_entity_data(arct);
+        add_to_map(&g_entity_map, entity.id, &entity_data);
+        revive_entity_gen(entity);
+
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        add_entity_to_table(&arct_data->ctable, entity);
+}
+
+size_t add_entities_to_arct(const struct Entity * entities, size_t count, struct Arct arct)
+{
+        // The entity data must exist before the table points it to
+        // its row.
+        struct EntityData entity_data = create_entity_data(arct);
+        for (size_t i = 0; i < count; ++i) {
+                add_to_map(&g_entity_map, entities[i].id, &entity_data);
+                revive_entity_gen(entities[i]);
+        }
+
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        return add_entities_to_table(&arct_data->ctable, entities, count);
+}
+
+void move_entity_to_arct(struct Entity entity, struct Arct arct)
+{
+        struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        struct ArctData * old_arct_data = get_map_element(&g_arct_map, entity_data->arct.id);
+        struct ArctData * new_arct_data = get_map_element(&g_arct_map, arct.id);
+
+        entity_data->arct = arct;
+        move_entity(&new_arct_data->ctable, &old_arct_data->ctable, entity);
+}
+
+size_t move_arct_rows(struct Arct dest, struct Arct src, size_t first_row, size_t row_count)
+{
+        struct ArctData * src_data = get_map_element(&g_arct_map, src.id);
+        struct ArctData * dest_data = get_map_element(&g_arct_map, dest.id);
+
+        for (size_t row = first_row; row < first_row + row_count; ++row) {
+                struct Entity entity = src_data->ctable.row_idx_to_entity[row];
+                struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+                entity_data->arct = dest;
+        }
+
+        return move_table_rows(&dest_data->ctable, &src_data->ctable, first_row, row_count);
+}
+
+static int compare_rows_descending(const void * row1_ptr, const void * row2_ptr)
+{
+        size_t row1 = *(const size_t *) row1_ptr;
+        size_t row2 = *(const size_t *) row2_ptr;
+        return (row1 < row2) - (row1 > row2);
+}
+
+void move_entities_to_arct(const struct Entity * entities, size_t count, struct Arct arct)
+{
+        if (count == 0) {
                 return;
         }
 
+        const struct EntityData * first_entity_data = get_map_element(&g_entity_map, entities[0].id);
+        struct Arct old_arct = first_entity_data->arct;
+
+        size_t * rows = ALLOC(size_t, count);
+        for (size_t i = 0; i < count; ++i) {
+                const struct EntityData * entity_data = get_map_element(&g_entity_map, entities[i].id);
+                ASSERT(arcts_equal(entity_data->arct, old_arct), ENTITY_FS " is not in " ARCT_FS ".",
+                        ENTITY_FA(entities[i]), ARCT_FA(old_arct));
+                rows[i] = entity_data->row;
+        }
+
+        // Moving the highest rows first means the rows filling the holes
+        // left in the table of "old_arct" are never ones that are still
+        // to be moved.
+        qsort(rows, count, sizeof(size_t), compare_rows_descending);
+
+        size_t run_start = 0;
+        while (run_start < count) {
+                size_t run_length = 1;
+                while (run_start + run_length < count && rows[run_start + run_length] + run_length == rows[run_start]) {
+                        ++run_length;
+                }
+
+                move_arct_rows(arct, old_arct, rows[run_start + run_length - 1], run_length);
+                run_start += run_length;
+        }
+
+        FREE(rows);
+}
+
+void remove_entity_from_arct(struct Entity entity)
+{
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        struct Arct arct = entity_data->arct;
+
+        // Call the "SYS_DESTROY" functions of all systems affecting "entity".
+        struct CGroup cgroup;
+        cgroup.entity = entity;
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        for (size_t i = 0; i < arct_data->systems.len; ++i) {
+
+                cgroup.sys.id = arct_data->systems.contents[i];
+                sys_func_t sys_destructor = get_sys_func(cgroup.sys, SYS_DESTROY);
+                if (sys_destructor != NULL) {
+                        sys_destructor(cgroup);
+                }
+
+                // The destroy functions may have created archetypes,
+                // moving the archetype map.
+                arct_data = get_map_element(&g_arct_map, arct.id);
+        }
+
+        destroy_table_entity(&arct_data->ctable, entity);
+        remove_from_map(&g_entity_map, entity.id);
+        kill_entity_gen(entity.id);
+}
+
+// Calls the "SYS_DESTROY" functions of all systems affecting "arct" on
+// the "row_count" entities from row "first_row". Structural changes
+// must be deferred by the caller, since they may move the rows.
+static void destroy_arct_rows_systems(struct Arct arct, size_t first_row, size_t row_count)
+{
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        for (size_t i = 0; i < arct_data->systems.len; ++i) {
+
+                struct CGroup cgroup;
+                cgroup.sys.id = arct_data->systems.contents[i];
+
+                sys_func_t sys_destructor = get_sys_func(cgroup.sys, SYS_DESTROY);
+                if (sys_destructor != NULL) {
+                        for (size_t row = first_row; row < first_row + row_count; ++row) {
+                                // "sys_destructor" may have created
+                                // archetypes, moving the archetype map.
+                                arct_data = get_map_element(&g_arct_map, arct.id);
+                                cgroup.entity = arct_data->ctable.row_idx_to_entity[row];
+                                sys_destructor(cgroup);
+                        }
+                }
+
+                arct_data = get_map_element(&g_arct_map, arct.id);
+        }
+}
+
+static void remove_arct_rows_entity_data(struct Arct arct, size_t first_row, size_t row_count)
+{
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        for (size_t row = first_row; row < first_row + row_count; ++row) {
+                pcecs_id_t id = arct_data->ctable.row_idx_to_entity[row].id;
+                remove_from_map(&g_entity_map, id);
+                kill_entity_gen(id);
+        }
+}
+
+void remove_arct_rows(struct Arct arct, size_t first_row, size_t row_count)
+{
+        // The changes made by the destroy functions are only carried out
+        // once the rows are gone.
+        begin_deferring_cmds();
+
+        destroy_arct_rows_systems(arct, first_row, row_count);
+
+        // The entities filling the removed rows are pointed to them by
+        // the table, so their "struct EntityData"s must still exist, but
+        // the removed ones can go first.
+        remove_arct_rows_entity_data(arct, first_row, row_count);
+
         struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        destroy_table_rows(&arct_data->ctable, first_row, row_count);
+
+        end_deferring_cmds();
+}
+
+void clear_arct(struct Arct arct)
+{
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        size_t row_count = arct_data->ctable.row_count;
+
+        // Same as in "remove_arct_rows".
+        begin_deferring_cmds();
+
+        destroy_arct_rows_systems(arct, 0, row_count);
+        remove_arct_rows_entity_data(arct, 0, row_count);
+
+        arct_data = get_map_element(&g_arct_map, arct.id);
+        clear_ctable(&arct_data->ctable);
+
+        end_deferring_cmds();
+}
+
+void start_entity_systems(struct Entity entity, struct Arct old_arct)
+{
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        struct Arct arct = entity_data->arct;
 
         struct CGroup cgroup;
-        cgroup.sys = sys;
+        cgroup.entity = entity;
 
-        struct Entity entity = first_entity_in_ctable(&arct_data->ctable);
-        while (entity.id != PCECS_INVALID_ID) {
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        for (size_t i = 0; i < arct_data->systems.len; ++i) {
+                cgroup.sys.id = arct_data->systems.contents[i];
+
+                // Systems that already affected "entity" were started
+                // back then.
+                if (old_arct.id != PCECS_INVALID_ID) {
+                        const struct ArctData * old_arct_data = get_map_element(&g_arct_map, old_arct.id);
+                        if (id_in_pool(&old_arct_data->systems, cgroup.sys.id)) {
+                                continue;
+                        }
+                }
 
-                cgroup.entity = entity;
-                sys_func(cgroup);
+                sys_func_t start_func = get_sys_func(cgroup.sys, SYS_START);
+                if (start_func != NULL) {
+                        start_func(cgroup);
+                }
 
-                entity = next_entity_in_ctable(&arct_data->ctable, entity);
+                // The start functions may have created archetypes, moving
+                // the archetype map.
+                arct_data = get_map_element(&g_arct_map, arct.id);
+        }
+}
+
+void start_arct_rows(struct Arct arct, struct Arct old_arct, size_t first_row, size_t row_count)
+{
+        // The rows can't move while the start functions are called.
+        begin_deferring_cmds();
+
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        for (size_t i = 0; i < arct_data->systems.len; ++i) {
+
+                struct CGroup cgroup;
+                cgroup.sys.id = arct_data->systems.contents[i];
+
+                // Same as in "start_entity_systems".
+                if (old_arct.id != PCECS_INVALID_ID) {
+                        const struct ArctData * old_arct_data = get_map_element(&g_arct_map, old_arct.id);
+                        if (id_in_pool(&old_arct_data->systems, cgroup.sys.id)) {
+                                continue;
+                        }
+                }
+
+                sys_func_t start_func = get_sys_func(cgroup.sys, SYS_START);
+                if (start_func != NULL) {
+                        for (size_t row = first_row; row < first_row + row_count; ++row) {
+                                // "start_func" may have created archetypes,
+                                // moving the archetype map.
+                                arct_data = get_map_element(&g_arct_map, arct.id);
+                                cgroup.entity = arct_data->ctable.row_idx_to_entity[row];
+                                start_func(cgroup);
+                        }
+                }
+
+                arct_data = get_map_element(&g_arct_map, arct.id);
+        }
+
+        end_deferring_cmds();
+}
+
+struct CBatch create_arct_batch(struct Arct arct, struct Sys sys, size_t first_row, size_t row_count)
+{
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        const struct CTable * ctable = &arct_data->ctable;
+
+        const struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+        const struct CtSet * requirements = &sys_data->requirements;
+
+        ASSERT(first_row + row_count <= ctable->row_count,
+                "Rows %d to %d are not in " CTABLE_FS ".",
+                (int) first_row, (int) (first_row + row_count), CTABLE_FA(*ctable));
+
+        ASSERT(row_count == 0 || first_row + row_count <= ctable_contiguous_end(ctable, first_row),
+                "Rows %d to %d of " CTABLE_FS " are not stored after each other.",
+                (int) first_row, (int) (first_row + row_count), CTABLE_FA(*ctable));
+
+        size_t column_count = cts_in_set_count(requirements);
+        struct Ct * cts = ALLOC(struct Ct, column_count);
+        void ** columns = ALLOC(void *, column_count);
+
+        // Look every column up once for the whole archetype rather than
+        // once for each of its entities.
+        size_t col_idx = 0;
+        struct Ct ct = first_ct_in_set(requirements);
+        while (ct.id != PCECS_INVALID_ID) {
+                cts[col_idx] = ct;
+                columns[col_idx] = get_table_component(ctable, first_row, ct);
+                ++col_idx;
+
+                ct = next_ct_in_set(requirements, ct);
+        }
+
+        return (struct CBatch) {
+                .sys = sys,
+                .row_count = row_count,
+                .entities = ctable->row_idx_to_entity + first_row,
+                .column_count = column_count,
+                .cts = cts,
+                .columns = columns
+        };
+}
+
+void destroy_arct_batch(struct CBatch * batch)
+{
+        // The casts only remove "const"; the lists were allocated by
+        // "create_arct_batch".
+        FREE((struct Ct *) batch->cts);
+        FREE((void **) batch->columns);
+}
+
+static void exec_batch_system(struct Arct arct, struct Sys sys, sys_batch_func_t batch_func)
+{
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+        // Calling a batch function with no entities would only waste
+        // the time it takes to set up the batch.
+        if (arct_data->ctable.row_count == 0) {
+                return;
+        }
+
+        // Entities added by the batch function are appended to the
+        // table, so they're not part of this round of batches.
+        size_t row_count = arct_data->ctable.row_count;
+        size_t batch_rows = get_sys_batch_rows(sys);
+        if (batch_rows == 0) {
+                batch_rows = row_count;
+        }
+
+        begin_ctable_read(&arct_data->ctable);
+        size_t first_row = 0;
+        while (first_row < row_count) {
+                // Batches can't cross the end of a chunk. The table can't
+                // change while it's read, so it doesn't matter that it may
+                // have moved with the archetype map.
+                arct_data = get_map_element(&g_arct_map, arct.id);
+                size_t batch_end = ctable_contiguous_end(&arct_data->ctable, first_row);
+                if (batch_end > first_row + batch_rows) {
+                        batch_end = first_row + batch_rows;
+                }
+
+                struct CBatch batch = create_arct_batch(arct, sys, first_row, batch_end - first_row);
+                batch_func(batch);
+                destroy_arct_batch(&batch);
+
+                first_row = batch_end;
+        }
+
+        // The batch function may have created archetypes, moving the
+        // archetype map and the table with it.
+        arct_data = get_map_element(&g_arct_map, arct.id);
+        end_ctable_read(&arct_data->ctable);
+}
+
+void exec_arct_system(struct Arct arct, struct Sys sys, enum SysFuncType func_type)
+{
+        sys_func_t sys_func = get_sys_func(sys, func_type);
+        if (sys_func != NULL) {
+                struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+                struct CGroup cgroup;
+                cgroup.sys = sys;
+
+                struct Entity entity = first_entity_in_ctable(&arct_data->ctable);
+                while (entity.id != PCECS_INVALID_ID) {
+
+                        cgroup.entity = entity;
+                        sys_func(cgroup);
+
+                        // Same as in "exec_batch_system"; "sys_func" may
+                        // have moved the archetype map.
+                        arct_data = get_map_element(&g_arct_map, arct.id);
+                        entity = next_entity_in_ctable(&arct_data->ctable, entity);
+                }
+        }
+
+        sys_batch_func_t batch_func = get_sys_batch_func(sys, func_type);
+        if (batch_func != NULL) {
+                exec_batch_system(arct, sys, batch_func);
         }
 }
 
@@ -138,6 +456,75 @@ void exec_arct_systems(struct Arct arct, enum SysFuncType func_type)
                 struct Sys sys;
                 sys.id = arct_data->systems.contents[i];
 
-                exec_single_system(arct, sys, func_type);
+                exec_arct_system(arct, sys, func_type);
+
+                // The systems may have created archetypes, moving the
+                // archetype map.
+                arct_data = get_map_element(&g_arct_map, arct.id);
+        }
+}
+
+// Unlinks "arct" from everything but the edges of other archetypes,
+// then destroys it and its ID.
+static void destroy_arct(struct Arct arct)
+{
+        LOG_DEBUG("Destroying " ARCT_FS " ...\n", ARCT_FA(arct));
+
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+        struct Ct ct = first_ct_in_set(&arct_data->ct_set);
+        while (ct.id != PCECS_INVALID_ID) {
+                struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+                remove_arct_from_ct(ct_data, arct);
+                ct = next_ct_in_set(&arct_data->ct_set, ct);
         }
+        remove_arct_from_queries(arct);
+        remove_arct_from_index(arct, &arct_data->ct_set);
+
+        remove_from_map(&g_arct_map, arct.id);
+        destroy_id_of_type(ID_MGR_ARCTS, arct.id);
+}
+
+size_t destroy_empty_arcts(size_t min_empty_passes)
+{
+        // The archetypes to destroy are all found before any of them is
+        // destroyed, so that the edges leading to them are removed in one
+        // pass over the edges of the others.
+        struct IdPool doomed = create_id_pool();
+
+        struct ArctData * arct_datas = g_arct_map.values;
+        for (map_idx_t i = 0; i < g_arct_map.length; ++i) {
+                struct ArctData * arct_data = &arct_datas[i];
+                const struct CTable * ctable = &arct_data->ctable;
+                if (ctable->row_count != 0 || ctable->reserved_rows != 0 || ctable_being_iterated(ctable)) {
+                        arct_data->empty_passes = 0;
+                        continue;
+                }
+
+                ++arct_data->empty_passes;
+                // Every entity starts out in the empty archetype, so
+                // there's no point in destroying it.
+                if (arct_data->empty_passes > min_empty_passes && !ct_set_empty(&arct_data->ct_set)) {
+                        add_to_id_pool(&doomed, g_arct_map.index_to_id[i]);
+                }
+        }
+
+        if (doomed.len != 0) {
+                for (map_idx_t i = 0; i < g_arct_map.length; ++i) {
+                        if (!id_in_pool(&doomed, g_arct_map.index_to_id[i])) {
+                                remove_edges_to_arcts(&arct_datas[i].edges, &doomed);
+                        }
+                }
+
+                for (size_t i = 0; i < doomed.len; ++i) {
+                        struct Arct arct = {
+                                .id = doomed.contents[i]
+                        };
+                        destroy_arct(arct);
+                }
+        }
+
+        size_t destroyed_count = doomed.len;
+        destroy_id_pool(&doomed);
+        return destroyed_count;
 }
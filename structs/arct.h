@@ -19,6 +19,11 @@ struct Arct {
 // archetype is returned.
 struct Arct create_arct(const struct CtSet * ct_set);
 
+// Returns the archetype with the components specified in "ct_set", or
+// an archetype with ID == "PCECS_INVALID_ID" if there is none. Unlike
+// "create_arct", this never changes any archetypes.
+struct Arct find_arct(const struct CtSet * ct_set);
+
 // Check for equality between two archetypes (whether they're the
 // same object; not whether they have the same component types
 // -- no different archetypes should have the same set of components
@@ -26,11 +31,91 @@ struct Arct create_arct(const struct CtSet * ct_set);
 // the component type set inputted).
 bool arcts_equal(struct Arct arct1, struct Arct arct2);
 
+// Adds "entity", which cannot be in any archetype yet, to "arct" and
+// maps it to its new "struct EntityData". The components of "entity"
+// will contain junk data.
+void add_entity_to_arct(struct Entity entity, struct Arct arct);
+
+// Same as "add_entity_to_arct" for all "count" entities of "entities",
+// which are added to consecutive rows of the table of "arct", growing
+// it only once. Returns the row of the first entity.
+size_t add_entities_to_arct(const struct Entity * entities, size_t count, struct Arct arct);
+
+// Moves "entity" from its current archetype to "arct", keeping the
+// components of the types found in both archetypes.
+void move_entity_to_arct(struct Entity entity, struct Arct arct);
+
+// Same as "move_entity_to_arct" for the "count" entities of "entities",
+// which must all be in the same archetype. Entities in consecutive rows
+// are moved together with "move_arct_rows".
+void move_entities_to_arct(const struct Entity * entities, size_t count, struct Arct arct);
+
+// Moves the "row_count" entities from row "first_row" of "src" to the
+// end of the table of "dest", keeping the components of the types found
+// in both archetypes. Each column is moved all at once. Returns the row
+// of the first moved entity in "dest".
+size_t move_arct_rows(struct Arct dest, struct Arct src, size_t first_row, size_t row_count);
+
+// Calls the destroy functions of every system affecting "entity"
+// before destroying its components and its "struct EntityData".
+// The ID of "entity" is left for the caller to destroy.
+void remove_entity_from_arct(struct Entity entity);
+
+// Same as "remove_entity_from_arct" for the "row_count" entities from
+// row "first_row" of "arct". The destroy functions are called one
+// system at a time, with structural changes made by them deferred until
+// the entities are removed, and the components are destroyed one column
+// at a time.
+void remove_arct_rows(struct Arct arct, size_t first_row, size_t row_count);
+
+// Same as "remove_arct_rows" for every entity of "arct", except the
+// table of "arct" keeps its storage.
+void clear_arct(struct Arct arct);
+
+// Calls the start functions of the systems affecting "entity" that
+// didn't affect it while it was in "old_arct". "old_arct" may have
+// ID == "PCECS_INVALID_ID" if "entity" is new, in which case every
+// system affecting "entity" is started.
+void start_entity_systems(struct Entity entity, struct Arct old_arct);
+
+// Calls the start functions of the systems affecting "arct" that didn't
+// affect "old_arct" on the "row_count" entities from row "first_row" of
+// its table, one system at a time. "old_arct" may have ID ==
+// "PCECS_INVALID_ID" if the entities are new, in which case every
+// system affecting "arct" is started. Structural changes made by the
+// start functions are deferred until every system is started.
+void start_arct_rows(struct Arct arct, struct Arct old_arct, size_t first_row, size_t row_count);
+
+// Creates a batch of the "row_count" entities from row "first_row" of
+// "arct" as seen by "sys" (see "cbatch.h"). "sys" must affect "arct",
+// and the rows must be in its table.
+// The batch points directly into the table of "arct", so it's only
+// valid while the table is read (see "begin_ctable_read") or until
+// entities are added to or removed from "arct".
+struct CBatch create_arct_batch(struct Arct arct, struct Sys sys, size_t first_row, size_t row_count);
+
+// Frees the resources allocated by "create_arct_batch".
+void destroy_arct_batch(struct CBatch * batch);
+
+// Execute the function of type "func_type" of "sys" on the entities
+// of "arct", which "sys" must affect.
+// Batch functions are called once for every "get_sys_batch_rows(sys)"
+// rows of "arct", or once for the whole archetype if that's 0.
+void exec_arct_system(struct Arct arct, struct Sys sys, enum SysFuncType func_type);
+
 // Execute one function depending on 'func_type' for each system in
 // 'arct'.
 void exec_arct_systems(struct Arct arct, enum SysFuncType func_type);
 
-// Archetypes cannot be destroyed, since they're referenced a lot of
-// places and cleaning that up would take a lot of time.
+// Destroys every archetype other than the one with no component types
+// that had no entities at this call and the "min_empty_passes" calls
+// before it, and no rows reserved for it (see "reserve_ctable_rows").
+// The archetypes are removed from the component types, queries and
+// edges of other archetypes referencing them, and their IDs are reused.
+// Returns the number of archetypes destroyed.
+// Cannot be called while any archetype has entities being moved or
+// tables being read, other than by iterations of empty tables, whose
+// archetypes are kept.
+size_t destroy_empty_arcts(size_t min_empty_passes);
 
 #endif
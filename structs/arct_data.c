@@ -4,18 +4,6 @@
 #include "sys_data.h"
 #include "ct_data.h"
 
-static void add_systems_to_arct_data(struct ArctData * arct_data)
-{
-        const struct SysData * sys_datas = g_sys_map.values;
-
-        for (map_idx_t i = 0; i < g_sys_map.length; ++i) {
-
-                if (ct_set_in_set(&sys_datas[i].requirements, &arct_data->ct_set)) {
-                        add_to_id_pool(&arct_data->systems, g_sys_map.index_to_id[i]);
-                }
-        }
-}
-
 struct ArctData create_arct_data(struct Arct arct, const struct CtSet * ct_set)
 {
         LOG_DEBUG("Creating archetype info from " CT_SET_FS " ...\n",
@@ -36,8 +24,24 @@ struct ArctData create_arct_data(struct Arct arct, const struct CtSet * ct_set)
 
         arct_data.edges = create_arct_edges(arct);
 
+        // Systems are added once the archetype is in the archetype map
+        // (see "add_arct_to_queries").
         arct_data.systems = create_id_pool();
-        add_systems_to_arct_data(&arct_data);
+
+        arct_data.empty_passes = 0;
 
         return arct_data;
 }
+
+void destroy_arct_data(struct ArctData * arct_data)
+{
+        destroy_ct_set(&arct_data->ct_set);
+        destroy_ctable(&arct_data->ctable);
+        destroy_arct_edges(&arct_data->edges);
+        destroy_id_pool(&arct_data->systems);
+}
+
+void destroy_arct_data_void(void * arct_data)
+{
+        destroy_arct_data((struct ArctData *) arct_data);
+}
@@ -30,6 +30,9 @@ struct ArctData {
         // from archetype to archetype, and jumping around
         // between different unrelated memory addresses is slow.
         struct IdPool systems;
+        // The number of calls to "destroy_empty_arcts" in a row that
+        // found the archetype without entities.
+        size_t empty_passes;
 };
 
 // Creates and initializes underlying data for "arct"
@@ -37,4 +40,12 @@ struct ArctData {
 // "ct_set".
 struct ArctData create_arct_data(struct Arct arct, const struct CtSet * ct_set);
 
+// Free the resources allocated by "arct_data", which must have no
+// entities.
+void destroy_arct_data(struct ArctData * arct_data);
+
+// Same as "destroy_arct_data", but using a void pointer argument
+// to generalize.
+void destroy_arct_data_void(void * arct_data);
+
 #endif
@@ -6,6 +6,10 @@
 #include "../globals/maps.h"
 #include "arct_data.h"
 
+#define MEM_TAG MEM_TAG_ARCT
+
+#define TRANSITIONS_CAPACITY_MUL 2
+
 struct ArctEdges create_arct_edges(struct Arct arct)
 {
         LOG_DEBUG("Creating archetype edges ...\n");
@@ -23,15 +27,54 @@ struct ArctEdges create_arct_edges(struct Arct arct)
         // Elements of the map are created as needed (lazy evaluation)
         // and provides a fast way to find archetypes with a set of
         // component types very similar to this one's.
-        // "noop" is passed as an argument for the destructor of map
-        // values. That's done to preserve archetypes referenced in
-        // the map even if the map is destroyed.
-        edges.edges = create_map(sizeof(struct Arct), NULL);
+        // No destructor is passed for the map values, so that the
+        // archetypes referenced in the map are preserved even if the
+        // map is destroyed.
+        edges.edges = create_paged_map(sizeof(struct Arct), NULL, CT_MAP_PAGE_SIZE);
+
+        edges.transitions = NULL;
+        edges.transition_count = 0;
+        edges.transition_capacity = 0;
 
         LOG_DEBUG("Created " ARCT_EDGES_FS ".\n", ARCT_EDGES_FA(edges));
         return edges;
 }
 
+void destroy_arct_edges(struct ArctEdges * edges)
+{
+        LOG_DEBUG("Destroying " ARCT_EDGES_FS " ...\n", ARCT_EDGES_FA(*edges));
+
+        destroy_map(&edges->edges);
+        for (size_t i = 0; i < edges->transition_count; ++i) {
+                destroy_ct_set(&edges->transitions[i].delta);
+        }
+        FREE(edges->transitions);
+}
+
+void remove_edges_to_arcts(struct ArctEdges * edges, const struct IdPool * arcts)
+{
+        // Going backwards, the edge moved into the place of a removed
+        // one has already been checked. The values may be reallocated
+        // by every removal.
+        for (map_idx_t i = edges->edges.length; i-- > 0; ) {
+                const struct Arct * edge_arct = (const struct Arct *) edges->edges.values + i;
+                if (id_in_pool(arcts, edge_arct->id)) {
+                        remove_from_map(&edges->edges, edges->edges.index_to_id[i]);
+                }
+        }
+
+        size_t kept_count = 0;
+        for (size_t i = 0; i < edges->transition_count; ++i) {
+                struct ArctTransition * transition = &edges->transitions[i];
+                if (id_in_pool(arcts, transition->dest.id)) {
+                        destroy_ct_set(&transition->delta);
+                } else {
+                        edges->transitions[kept_count++] = *transition;
+                }
+        }
+        edges->transition_count = kept_count;
+}
+
 // I might write a faster function for this later, working
 // with the underlying implementation of "struct CtSet".
 // However, a small optimization like that isn't really
@@ -121,6 +164,80 @@ static struct Arct get_edge(struct ArctEdges * edges, struct Ct toggled_ct)
         return create_edge(edges, toggled_ct);
 }
 
+// Returns the cached transition of "edges" adding or removing "delta",
+// or NULL if there is none.
+static const struct ArctTransition * find_transition(const struct ArctEdges * edges,
+        const struct CtSet * delta, uint64_t delta_hash, bool add)
+{
+        for (size_t i = 0; i < edges->transition_count; ++i) {
+                const struct ArctTransition * transition = &edges->transitions[i];
+                if (transition->delta_hash == delta_hash && transition->add == add &&
+                        ct_sets_equal(&transition->delta, delta)) {
+
+                        return transition;
+                }
+        }
+        return NULL;
+}
+
+static void add_transition(struct ArctEdges * edges, struct ArctTransition transition)
+{
+        if (edges->transition_count == edges->transition_capacity) {
+                size_t capacity = edges->transition_capacity * TRANSITIONS_CAPACITY_MUL;
+                edges->transition_capacity = capacity ? capacity : 1;
+                REALLOC(&edges->transitions, struct ArctTransition, edges->transition_capacity);
+        }
+        edges->transitions[edges->transition_count++] = transition;
+}
+
+// Gets the archetype with the component types of "cts" added to or
+// removed from "edges->arct", creating and caching the transition if
+// it doesn't exist.
+static struct Arct get_transition(struct ArctEdges * edges, const struct CtSet * cts, bool add)
+{
+        // Single component types have edges of their own.
+        struct Ct first_ct = first_ct_in_set(cts);
+        if (first_ct.id == PCECS_INVALID_ID) {
+                return edges->arct;
+        }
+        if (next_ct_in_set(cts, first_ct).id == PCECS_INVALID_ID) {
+                return get_edge(edges, first_ct);
+        }
+
+        uint64_t delta_hash = ct_set_hash(cts);
+        const struct ArctTransition * found = find_transition(edges, cts, delta_hash, add);
+        if (found != NULL) {
+                LOG_DEBUG("Finding archetype transition ...\n");
+                return found->dest;
+        }
+
+        LOG_DEBUG("Creating archetype transition ...\n");
+
+        // The component types of the destination are computed all at
+        // once, so none of the archetypes in between are created.
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, edges->arct.id);
+        struct CtSet dest_ct_set = add ? ct_set_union(&arct_data->ct_set, cts) :
+                ct_set_difference(&arct_data->ct_set, cts);
+
+        // Same as in "create_edge", "edges" may be invalidated by
+        // creating an archetype.
+        struct Arct arct = edges->arct;
+        struct Arct dest = create_arct(&dest_ct_set);
+        destroy_ct_set(&dest_ct_set);
+        edges = get_arct_edges(arct);
+
+        struct ArctTransition transition = {
+                .delta_hash = delta_hash,
+                .delta = create_ct_set(),
+                .add = add,
+                .dest = dest
+        };
+        copy_ct_set(&transition.delta, cts);
+        add_transition(edges, transition);
+
+        return dest;
+}
+
 #ifdef ASSERTIONS
 // Returns "true" if entities of "arct" contains a component of
 // type "ct", otherwise "false".
@@ -130,6 +247,22 @@ static bool ct_in_arct(struct Arct arct, struct Ct ct)
         const struct CtSet * ct_set = &arct_data->ct_set;
         return ct_in_set(ct_set, ct);
 }
+
+// Returns "true" if entities of "arct" contain a component of every
+// type in "cts", otherwise "false".
+static bool cts_in_arct(struct Arct arct, const struct CtSet * cts)
+{
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        return ct_set_in_set(cts, &arct_data->ct_set);
+}
+
+// Returns "true" if entities of "arct" contain a component of any type
+// in "cts", otherwise "false".
+static bool any_ct_in_arct(struct Arct arct, const struct CtSet * cts)
+{
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+        return ct_sets_intersect(cts, &arct_data->ct_set);
+}
 #endif
 
 struct Arct get_edge_with_ct(struct ArctEdges * edges, struct Ct ct)
@@ -168,3 +301,39 @@ struct Arct get_edge_without_ct(struct ArctEdges * edges, struct Ct ct)
         LOG_DEBUG("Got edge " ARCT_FS ".\n", ARCT_FA(edge));
         return edge;
 }
+
+struct Arct get_edge_with_cts(struct ArctEdges * edges, const struct CtSet * cts)
+{
+        LOG_DEBUG("Getting edge with " CT_SET_FS " in " ARCT_EDGES_FS " ...\n",
+                CT_SET_FA(cts), ARCT_EDGES_FA(*edges));
+
+        ASSERT(!any_ct_in_arct(edges->arct, cts),
+                "Already some of " CT_SET_FS " in " ARCT_FS ".", CT_SET_FA(cts), ARCT_FA(edges->arct));
+
+        struct Arct edge = get_transition(edges, cts, true);
+
+        LOG_DEBUG("Got edge " ARCT_FS ".\n", ARCT_FA(edge));
+        return edge;
+}
+
+struct Arct get_edge_without_cts(struct ArctEdges * edges, const struct CtSet * cts)
+{
+        LOG_DEBUG("Getting edge without " CT_SET_FS " in " ARCT_EDGES_FS " ...\n",
+                CT_SET_FA(cts), ARCT_EDGES_FA(*edges));
+
+        ASSERT(cts_in_arct(edges->arct, cts),
+                "Not all of " CT_SET_FS " in " ARCT_FS ".", CT_SET_FA(cts), ARCT_FA(edges->arct));
+
+        struct Arct edge = get_transition(edges, cts, false);
+
+        LOG_DEBUG("Got edge " ARCT_FS ".\n", ARCT_FA(edge));
+        return edge;
+}
+
+struct PcecsMemUsage arct_edges_mem_usage(const struct ArctEdges * edges)
+{
+        struct PcecsMemUsage usage = map_mem_usage(&edges->edges);
+        usage.used += edges->transition_count * sizeof(struct ArctTransition);
+        usage.reserved += edges->transition_capacity * sizeof(struct ArctTransition);
+        return usage;
+}
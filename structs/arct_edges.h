@@ -3,21 +3,62 @@
 
 #include "../tools/mem_tools.h"
 #include "../interface/ct.h"
+#include "../interface/ct_set.h"
+#include "../interface/mem_stats.h"
+#include "../ids/id_pool.h"
 #include "arct.h"
 #include "map.h"
 
 #define ARCT_EDGES_FS "archetype edges (%d initialized)"
 #define ARCT_EDGES_FA(arct_edges) (int) (arct_edges).edges.length
 
+// The archetype reached from the archetype of some edges by adding or
+// removing all the component types of "delta" at once.
+struct ArctTransition {
+        // "ct_set_hash" of "delta", compared before "delta" itself.
+        uint64_t delta_hash;
+        struct CtSet delta;
+        bool add;
+        struct Arct dest;
+};
+
 struct ArctEdges {
         struct Arct arct;
         struct Map edges;
+        // Transitions adding or removing more than one component type,
+        // created as needed like "edges". An archetype is rarely changed
+        // in many different ways at once, so they're searched one by
+        // one.
+        struct ArctTransition * transitions;
+        size_t transition_count;
+        size_t transition_capacity;
 };
 
 struct ArctEdges create_arct_edges(struct Arct arct);
 
+// Frees the edges and transitions, but not the archetypes they lead to.
+void destroy_arct_edges(struct ArctEdges * edges);
+
+// Forgets every edge and transition leading to one of "arcts", which are
+// about to be destroyed.
+void remove_edges_to_arcts(struct ArctEdges * edges, const struct IdPool * arcts);
+
 struct Arct get_edge_with_ct(struct ArctEdges * edges, struct Ct ct);
 
 struct Arct get_edge_without_ct(struct ArctEdges * edges, struct Ct ct);
 
+// Returns the archetype with the component types of "edges->arct" and
+// "cts", none of which may be in "edges->arct". Found without creating
+// any of the archetypes in between, and cached for next time.
+struct Arct get_edge_with_cts(struct ArctEdges * edges, const struct CtSet * cts);
+
+// Returns the archetype with the component types of "edges->arct" but
+// not "cts", all of which must be in "edges->arct". See
+// "get_edge_with_cts".
+struct Arct get_edge_without_cts(struct ArctEdges * edges, const struct CtSet * cts);
+
+// The memory allocated for the edges and transitions, not counting the
+// sets of component types of the transitions.
+struct PcecsMemUsage arct_edges_mem_usage(const struct ArctEdges * edges);
+
 #endif
@@ -0,0 +1,161 @@
+#include "arct_index.h"
+#include "arct_data.h"
+#include "../globals/maps.h"
+#include "../tools/mem_tools.h"
+#include "../tools/log.h"
+
+#define MEM_TAG MEM_TAG_ARCT
+
+#define ARCT_INDEX_MIN_CAPACITY 64
+
+// A slot of the hash table, empty if "arct_id" == "PCECS_INVALID_ID".
+// The hash of the component types is kept in the slot, so that the sets
+// of other archetypes are only compared when the hashes are equal.
+struct ArctIndexSlot {
+        uint64_t hash;
+        pcecs_id_t arct_id;
+};
+
+// Open addressing with linear probing. The capacity is a power of two,
+// and at most half of the slots are used. Slots are emptied with
+// backward-shift deletion, so no slot is ever a tombstone.
+static struct ArctIndexSlot * g_arct_index_slots = NULL;
+static size_t g_arct_index_capacity = 0;
+static size_t g_arct_index_count = 0;
+
+// The archetype with no component types, which many entities pass
+// through when they're created, has a slot of its own.
+static struct Arct g_empty_arct = {
+        .id = PCECS_INVALID_ID
+};
+
+static void insert_arct_index_slot(struct ArctIndexSlot slot)
+{
+        size_t mask = g_arct_index_capacity - 1;
+        size_t i = (size_t) slot.hash & mask;
+        while (g_arct_index_slots[i].arct_id != PCECS_INVALID_ID) {
+                i = (i + 1) & mask;
+        }
+        g_arct_index_slots[i] = slot;
+}
+
+static void grow_arct_index(void)
+{
+        struct ArctIndexSlot * old_slots = g_arct_index_slots;
+        size_t old_capacity = g_arct_index_capacity;
+
+        g_arct_index_capacity = old_capacity ? old_capacity * 2 : ARCT_INDEX_MIN_CAPACITY;
+        LOG_DEBUG("Growing the archetype index to %d slots.\n", (int) g_arct_index_capacity);
+
+        g_arct_index_slots = ALLOC(struct ArctIndexSlot, g_arct_index_capacity);
+        for (size_t i = 0; i < g_arct_index_capacity; ++i) {
+                g_arct_index_slots[i].arct_id = PCECS_INVALID_ID;
+        }
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+                if (old_slots[i].arct_id != PCECS_INVALID_ID) {
+                        insert_arct_index_slot(old_slots[i]);
+                }
+        }
+        FREE(old_slots);
+}
+
+void add_arct_to_index(struct Arct arct, const struct CtSet * ct_set)
+{
+        LOG_DEBUG("Adding " ARCT_FS " to the archetype index.\n", ARCT_FA(arct));
+
+        ASSERT(find_indexed_arct(ct_set).id == PCECS_INVALID_ID,
+                CT_SET_FS " already has an archetype.", CT_SET_FA(ct_set));
+
+        if (ct_set_empty(ct_set)) {
+                g_empty_arct = arct;
+                return;
+        }
+
+        if ((g_arct_index_count + 1) * 2 > g_arct_index_capacity) {
+                grow_arct_index();
+        }
+        insert_arct_index_slot((struct ArctIndexSlot) {
+                .hash = ct_set_hash(ct_set),
+                .arct_id = arct.id
+        });
+        ++g_arct_index_count;
+}
+
+void remove_arct_from_index(struct Arct arct, const struct CtSet * ct_set)
+{
+        LOG_DEBUG("Removing " ARCT_FS " from the archetype index.\n", ARCT_FA(arct));
+
+        ASSERT(arcts_equal(find_indexed_arct(ct_set), arct),
+                ARCT_FS " is not indexed by " CT_SET_FS ".", ARCT_FA(arct), CT_SET_FA(ct_set));
+
+        if (ct_set_empty(ct_set)) {
+                g_empty_arct.id = PCECS_INVALID_ID;
+                return;
+        }
+
+        size_t mask = g_arct_index_capacity - 1;
+        size_t i = (size_t) ct_set_hash(ct_set) & mask;
+        while (g_arct_index_slots[i].arct_id != arct.id) {
+                i = (i + 1) & mask;
+        }
+
+        // Shift every following slot of the probe sequence back into the
+        // hole, unless that would put it before its home slot, so that
+        // no slot is ever separated from its home by an empty one.
+        size_t hole = i;
+        for (size_t j = (hole + 1) & mask; g_arct_index_slots[j].arct_id != PCECS_INVALID_ID;
+                j = (j + 1) & mask) {
+
+                size_t home = (size_t) g_arct_index_slots[j].hash & mask;
+                if (((j - home) & mask) >= ((j - hole) & mask)) {
+                        g_arct_index_slots[hole] = g_arct_index_slots[j];
+                        hole = j;
+                }
+        }
+        g_arct_index_slots[hole].arct_id = PCECS_INVALID_ID;
+        --g_arct_index_count;
+}
+
+struct Arct find_indexed_arct(const struct CtSet * ct_set)
+{
+        if (ct_set_empty(ct_set)) {
+                return g_empty_arct;
+        }
+        if (g_arct_index_count == 0) {
+                return (struct Arct) {
+                        .id = PCECS_INVALID_ID
+                };
+        }
+
+        uint64_t hash = ct_set_hash(ct_set);
+        size_t mask = g_arct_index_capacity - 1;
+        for (size_t i = (size_t) hash & mask; g_arct_index_slots[i].arct_id != PCECS_INVALID_ID;
+                i = (i + 1) & mask) {
+
+                const struct ArctIndexSlot * slot = &g_arct_index_slots[i];
+                if (slot->hash != hash) {
+                        continue;
+                }
+
+                // Different sets may still hash the same.
+                const struct ArctData * arct_data = get_map_element(&g_arct_map, slot->arct_id);
+                if (ct_sets_equal(&arct_data->ct_set, ct_set)) {
+                        return (struct Arct) {
+                                .id = slot->arct_id
+                        };
+                }
+        }
+
+        return (struct Arct) {
+                .id = PCECS_INVALID_ID
+        };
+}
+
+struct PcecsMemUsage arct_index_mem_usage(void)
+{
+        return (struct PcecsMemUsage) {
+                .used = g_arct_index_count * sizeof(struct ArctIndexSlot),
+                .reserved = g_arct_index_capacity * sizeof(struct ArctIndexSlot)
+        };
+}
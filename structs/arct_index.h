@@ -0,0 +1,29 @@
+// An index from the component types of every archetype to the archetype,
+// so that finding the archetype of a set of component types takes
+// constant time instead of comparing it to the sets of archetypes one
+// by one. Archetypes are added to it by "create_arct", and removed when
+// they're destroyed.
+
+#ifndef ARCT_INDEX_H
+#define ARCT_INDEX_H
+
+#include "arct.h"
+#include "../interface/ct_set.h"
+#include "../interface/mem_stats.h"
+
+// Adds "arct", which has the component types in "ct_set", to the index.
+// No archetype with the same component types can be in the index.
+void add_arct_to_index(struct Arct arct, const struct CtSet * ct_set);
+
+// Removes "arct", which has the component types in "ct_set", from the
+// index.
+void remove_arct_from_index(struct Arct arct, const struct CtSet * ct_set);
+
+// Returns the archetype with the component types in "ct_set", or an
+// archetype with ID == "PCECS_INVALID_ID" if there is none.
+struct Arct find_indexed_arct(const struct CtSet * ct_set);
+
+// The memory allocated for the index.
+struct PcecsMemUsage arct_index_mem_usage(void);
+
+#endif
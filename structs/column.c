@@ -5,30 +5,52 @@
 #include "ct_data.h"
 #include "../globals/maps.h"
 
+#define MEM_TAG MEM_TAG_COLUMN
+
 struct Column create_column(struct Ct ct, size_t capacity)
 {
         struct Column col;
 
         const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
         col.component_size = ct_data->size;
+        col.alignment = ct_data->alignment > COLUMN_ALIGNMENT ? ct_data->alignment : COLUMN_ALIGNMENT;
+        col.capacity = capacity;
+        col.chunk_offset = 0;
 
         // Allocate enough space for "capacity" components of size
         // "col.component_size".
         // "sizeof(void) == 0" isn't standard (not that I have a reason to
         // care as I only use one compiler and operating system anyway), so
         // "byte_t" is used as an allocation unit.
-        col.components = ALLOC(byte_t, capacity * col.component_size);
+        col.components = ALLOC_ALIGNED(byte_t, capacity * col.component_size, col.alignment);
         return col;
 }
 
-void resize_column(struct Column * col, size_t count)
+void destroy_column(struct Column * col)
+{
+        FREE_ALIGNED(col->components, col->alignment);
+        col->components = NULL;
+        col->capacity = 0;
+}
+
+void resize_column(struct Column * col, size_t count, size_t live_count)
 {
         LOG_DEBUG("Resizing " COL_FS " to %d instances of size %d ...\n",
                 COL_FA(col), (int) count, (int) col->component_size);
 
-        // Resize "col->components" to "count" components of size
-        // "col->component_size".
+        ASSERT(live_count <= count && live_count <= col->capacity,
+                "Cannot keep %d components when resizing " COL_FS " from %d to %d.",
+                (int) live_count, COL_FA(col), (int) col->capacity, (int) count);
+
+        // "realloc" doesn't keep the alignment, so the components are
+        // moved by hand. Only the live ones need to be, so this is also
+        // cheaper than "realloc" copying the whole old buffer.
         // Again, sizeof(void) == 1 is not standard so "byte_t"s are
         // used instead.
-        REALLOC(&col->components, byte_t, col->component_size * count);
+        byte_t * components = ALLOC_ALIGNED(byte_t, col->component_size * count, col->alignment);
+        COPY_MEMORY(components, col->components, byte_t, col->component_size * live_count);
+        FREE_ALIGNED(col->components, col->alignment);
+
+        col->components = components;
+        col->capacity = count;
 }
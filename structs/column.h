@@ -12,8 +12,14 @@
 #define COL_FS "col%s"
 #define COL_FA(col) ""
 
+// The least alignment of the components of a column, in bytes. The size
+// of a cache line, so that a column never shares its first cache line
+// with other data.
+#define COLUMN_ALIGNMENT 64
+
 // The table owning the column is responsible for keeping track
-// of the column's capacity and component type.
+// of the column's component type and how many of its components
+// are in use.
 struct Column {
         // A buffer of components for the column.
         void * components;
@@ -26,16 +32,29 @@ struct Column {
         // a pointer member and padding the size should still
         // be 8. Also, I don't use Linux and never will).
         size_t component_size;
+        // The alignment of "components", which is the alignment of the
+        // component type or "COLUMN_ALIGNMENT", whichever is greater.
+        size_t alignment;
+        // The number of components that fit in "components".
+        size_t capacity;
+        // Where the components of the column start within each chunk of
+        // a chunked table, which leaves "components" NULL (see
+        // "struct CTable").
+        size_t chunk_offset;
 };
 
 // Creates a column with capacity for "capacity" individual components
 // of type "ct". No components are initialized.
 struct Column create_column(struct Ct ct, size_t capacity);
 
-// Resizes a column to "count" components.
+// Frees the components of a column, without destroying any of them.
+void destroy_column(struct Column * col);
+
+// Resizes a column to "count" components, keeping the first
+// "live_count" ones.
 // No components will be destroyed, even if "col" is resized to a
 // size lower than its number of components (in fact, "col" doesn't
 // even know how many components it actually contains).
-void resize_column(struct Column * col, size_t count);
+void resize_column(struct Column * col, size_t count, size_t live_count);
 
 #endif
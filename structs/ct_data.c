@@ -3,14 +3,17 @@
 
 #define ARCT_POOL_CAPACITY_MUL 2
 
-struct CtData create_ct_data(size_t size, void (* destructor)(void * component))
+struct CtData create_ct_data(size_t size, size_t alignment, void (* destructor)(void * component))
 {
-        LOG_DEBUG("Creating component type info of size %d ...\n", (int) size);
+        LOG_DEBUG("Creating component type info of size %d and alignment %d ...\n",
+                (int) size, (int) alignment);
 
         struct CtData ct_data = {
                 // A newly created component type doesn't belong to any archetypes.
                 .arcts = create_id_pool(),
+                .queries = create_id_pool(),
                 .size = size,
+                .alignment = alignment,
                 .destructor = destructor
         };
 
@@ -23,3 +26,8 @@ void add_arct_to_ct(struct CtData * ct, struct Arct arct)
 {
         add_to_id_pool(&ct->arcts, arct.id);
 }
+
+void remove_arct_from_ct(struct CtData * ct, struct Arct arct)
+{
+        remove_from_id_pool(&ct->arcts, arct.id);
+}
@@ -17,16 +17,28 @@ struct CtData {
         // The archetypes whose entities contains a component of
         // this type.
         struct IdPool arcts;
+        // The queries indexed by this component type (see "query.h").
+        // A query is only indexed by the first component type of its
+        // requirements, even though it requires others too.
+        struct IdPool queries;
         // The size of a component of this type, in bytes.
         size_t size;
+        // The alignment of a component of this type, in bytes. Always
+        // a power of two that "size" is a multiple of.
+        size_t alignment;
         // The method used to destroy instances of this type.
         // "component" is a pointer to the component.
         void (* destructor)(void * component);
 };
 
+// The destructor of component types created without one (see
+// "create_ct"). Nothing needs to be done to destroy their components.
+void noop(void * arg);
+
 // Creates a new "CtData" structure, where each instance has size
-// "size" and is destroyed by "destructor".
-struct CtData create_ct_data(size_t size, void (* destructor)(void * component));
+// "size", is aligned to "alignment" bytes and is destroyed by
+// "destructor".
+struct CtData create_ct_data(size_t size, size_t alignment, void (* destructor)(void * component));
 
 // Destroys a "struct CtData".
 // So far, calling it is not legal since the only reason to
@@ -45,4 +57,7 @@ void destroy_ct_data_void(void * ct_data);
 // Must be called shortly after "arct" is created.
 void add_arct_to_ct(struct CtData * ct, struct Arct arct);
 
+// Makes "ct" forget about "arct", which is being destroyed.
+void remove_arct_from_ct(struct CtData * ct, struct Arct arct);
+
 #endif
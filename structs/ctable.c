@@ -6,24 +6,37 @@
 #include "ct_data.h"
 #include "../globals/maps.h"
 #include "../interface/ct.h"
+#include "entity_data.h"
+
+#define MEM_TAG MEM_TAG_CTABLE
 
 #define BITS_IN_BYTE CHAR_BIT
 #define ROWS_CAPACITY_MUL 2
 
-// "row_idx_t" is an integer type. And if I ever encounter an integer type
-// where a value of all 1-bits is not super high or negative, I will stop
-// programming forever and then it won't matter if this program blows up.
-#define INVALID_ROW_IDX (~((row_idx_t) 0))
+// Tables only shrink once no more than a quarter of their capacity is in
+// use, and then to twice their row count. Shrinking as soon as half of
+// it was unused would make a table going back and forth over a power of
+// two resize every time.
+#define ROWS_SHRINK_DIV 4
 
-#define CELL_FS "cell (" CT_FS ", " ENTITY_FS ")"
-#define CELL_FA(cell) CT_FA((cell).ct), ENTITY_FA((cell).entity)
+#define CELL_FS "cell (" CT_FS ", row %d)"
+#define CELL_FA(cell) CT_FA((cell).ct), (int) (cell).row
 
 struct Cell {
         const struct CTable * table;
         struct Ct ct;
-        struct Entity entity;
+        row_idx_t row;
 };
 
+// The size of the chunks of tables created from now on, or 0 if they
+// should have one buffer per column (see "set_ctable_chunk_size").
+static size_t g_ctable_chunk_size = 0;
+
+void set_ctable_chunk_size(size_t chunk_size)
+{
+        g_ctable_chunk_size = chunk_size;
+}
+
 // Find the minimum "valid" capacity for rows greater than or
 // equal to "req_capacity".
 // By increasing capacity step by step, we don't need to resize
@@ -34,7 +47,65 @@ static size_t min_valid_rows_capacity(size_t req_capacity)
         while (capacity < req_capacity) {
                 capacity *= ROWS_CAPACITY_MUL;
         }
-        return capacity;
+        return capacity < MAX_ROW_COUNT ? capacity : MAX_ROW_COUNT;
+}
+
+// Places the columns of "table" after each other within a chunk of
+// "rows_per_chunk" rows, and returns the size of such a chunk.
+static size_t lay_out_chunk(struct CTable * table, row_idx_t rows_per_chunk)
+{
+        size_t chunk_size = 0;
+        for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
+                struct Column * col = (struct Column *) table->ct_to_col.values + i;
+
+                // Round up to the alignment of the column.
+                chunk_size = (chunk_size + col->alignment - 1) & ~(col->alignment - 1);
+                col->chunk_offset = chunk_size;
+                chunk_size += col->component_size * rows_per_chunk;
+        }
+        return chunk_size;
+}
+
+// Splits the storage of "table" into chunks of at most "chunk_size"
+// bytes, fitting as many rows in each as possible. Tables whose rows
+// take no space are left with one buffer per column.
+static void use_chunks(struct CTable * table, size_t chunk_size)
+{
+        size_t row_size = 0;
+        table->chunk_alignment = COLUMN_ALIGNMENT;
+        for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
+                const struct Column * col = (struct Column *) table->ct_to_col.values + i;
+                row_size += col->component_size;
+                if (col->alignment > table->chunk_alignment) {
+                        table->chunk_alignment = col->alignment;
+                }
+        }
+        if (row_size == 0) {
+                return;
+        }
+
+        // The padding between the columns may leave room for fewer rows
+        // than "chunk_size / row_size". A chunk always has room for at
+        // least one row, even if it makes it larger than "chunk_size".
+        row_idx_t rows_per_chunk = chunk_size / row_size;
+        while (rows_per_chunk > 1 && lay_out_chunk(table, rows_per_chunk) > chunk_size) {
+                --rows_per_chunk;
+        }
+        if (rows_per_chunk == 0) {
+                rows_per_chunk = 1;
+        }
+
+        table->rows_per_chunk = rows_per_chunk;
+        table->chunk_size = lay_out_chunk(table, rows_per_chunk);
+
+        // There are no chunks until the first row is added.
+        table->rows_capacity = 0;
+
+        // The components are in the chunks from now on.
+        for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
+                struct Column * col = (struct Column *) table->ct_to_col.values + i;
+                destroy_column(col);
+        }
 }
 
 struct CTable create_ctable(const struct CtSet * cts)
@@ -45,11 +116,9 @@ struct CTable create_ctable(const struct CtSet * cts)
         struct CTable table;
 
         // Initialize component type to column map with no elements.
-        // "Column"s are indestructible since "CTable"s are
-        // indestructible since "ArctData"s are indestructible since
-        // "Arct"s are indestructible. Therefore, we don't
-        // provide a destructor for the column map.
-        table.ct_to_col = create_map(sizeof(struct Column), NULL);
+        // Columns are only destroyed along with the whole table (see
+        // "destroy_ctable"), so the map has no destructor.
+        table.ct_to_col = create_paged_map(sizeof(struct Column), NULL, CT_MAP_PAGE_SIZE);
 
         // "rows_capacity" is really the capacity of every column, and
         // since there's no rows yet (rows are entities, and a newly
@@ -70,305 +139,460 @@ struct CTable create_ctable(const struct CtSet * cts)
         }
 
         table.row_count = 0;
-
-        // If this variable should for some reason not be initialized to 0,
-        // the row indices in "table.entity_to_row_idx" should be set to
-        // "INVALID_ROW_IDX" to mark that no entity IDs can be mapped to
-        // row indices yet.
-        table.entity_to_row_size = 0;
-
-        // No "minimum capacity" function is needed for "entity_to_row_idx",
-        // as it will be resized exactly as needed and will never shrink
-        // since it's far less predictable than simple list (going from
-        // 0 to 1 elements might change the capacity from 0 to 100 if the
-        // entity has ID 99).
-        table.entity_to_row_idx = ALLOC(row_idx_t, table.entity_to_row_size);
+        table.reserved_rows = 0;
 
         table.row_idx_to_entity = ALLOC(struct Entity, table.rows_capacity);
 
-        table.row_idx_skipped = ALLOC(bool, table.rows_capacity);
-        for (row_idx_t i = 0; i < table.rows_capacity; ++i) {
-                table.row_idx_skipped[i] = false;
+        table.rows_per_chunk = 0;
+        table.chunks = NULL;
+        table.chunk_count = 0;
+        table.chunk_size = 0;
+        table.chunk_alignment = 0;
+        if (g_ctable_chunk_size != 0) {
+                use_chunks(&table, g_ctable_chunk_size);
         }
 
-        table.removed_entities = create_id_pool();
-        table.destroyed_entities = create_id_pool();
-
-        table.iterator.id = PCECS_INVALID_ID;
+        table.reader_count = 0;
 
         LOG_DEBUG("Created " CTABLE_FS ".\n", CTABLE_FA(table));
         return table;
 }
 
-static void set_entity_to_row_size(struct CTable * table, size_t size)
+void destroy_ctable(struct CTable * table)
 {
-        ASSERT(size > table->entity_to_row_size, "Entity row size cannot decrease.");
+        LOG_DEBUG("Destroying " CTABLE_FS " ...\n", CTABLE_FA(*table));
+
+        ASSERT(table->row_count == 0, "Cannot destroy " CTABLE_FS " with rows.", CTABLE_FA(*table));
+        ASSERT(!ctable_being_iterated(table), "Cannot destroy " CTABLE_FS " while it's read.",
+                CTABLE_FA(*table));
 
-        REALLOC(&table->entity_to_row_idx, struct Entity, size);
+        // The columns of chunked tables have no buffers of their own, and
+        // destroying them again does nothing.
+        for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
+                struct Column * col = (struct Column *) table->ct_to_col.values + i;
+                destroy_column(col);
+        }
+        destroy_map(&table->ct_to_col);
 
-        // For each element in "entity_to_row_idx", initialize it to
-        // an invalid row index to show that the entity with ID "i"
-        // is not in the table, and therefore does not map to a row
-        // index within the table.
-        for (row_idx_t i = table->entity_to_row_size; i < size; ++i) {
-                table->entity_to_row_idx[i] = INVALID_ROW_IDX;
+        for (size_t i = 0; i < table->chunk_count; ++i) {
+                FREE_ALIGNED(table->chunks[i], table->chunk_alignment);
         }
-        table->entity_to_row_size = size;
+        FREE(table->chunks);
+        FREE(table->row_idx_to_entity);
 }
 
-static void set_rows_capacity(struct CTable * table, size_t capacity)
+static void set_chunk_count(struct CTable * table, size_t chunk_count)
 {
-        size_t valid_capacity = min_valid_rows_capacity(capacity);
+        LOG_DEBUG("Changing the chunk count of " CTABLE_FS " from %d to %d ...\n",
+                CTABLE_FA(*table), (int) table->chunk_count, (int) chunk_count);
+
+        // Chunks beyond the new count are freed before the list shrinks,
+        // and new chunks are allocated after it grows. The chunks that
+        // are kept are never moved.
+        for (size_t i = chunk_count; i < table->chunk_count; ++i) {
+                FREE_ALIGNED(table->chunks[i], table->chunk_alignment);
+        }
+        REALLOC(&table->chunks, byte_t *, chunk_count);
+        for (size_t i = table->chunk_count; i < chunk_count; ++i) {
+                table->chunks[i] = ALLOC_ALIGNED(byte_t, table->chunk_size, table->chunk_alignment);
+        }
+        table->chunk_count = chunk_count;
+}
 
-        REALLOC(&table->row_idx_to_entity, struct Entity, valid_capacity);
-        REALLOC(&table->row_idx_skipped, bool, valid_capacity);
+// Sets the capacity of "table" to exactly "capacity" rows, or the
+// fewest whole chunks holding them if "table" is chunked.
+static void set_rows_capacity(struct CTable * table, size_t capacity)
+{
+        LOG_DEBUG("Changing the capacity of " CTABLE_FS " from %d to %d rows ...\n",
+                CTABLE_FA(*table), (int) table->rows_capacity, (int) capacity);
+
+        // Chunked tables grow by one chunk at a time, without touching
+        // the chunks they already have.
+        if (table->rows_per_chunk != 0) {
+                size_t chunk_count = (capacity + table->rows_per_chunk - 1) / table->rows_per_chunk;
+                set_chunk_count(table, chunk_count);
+                capacity = chunk_count * table->rows_per_chunk;
+        } else {
+                // For each column in the component type to column map,
+                // resize the column. When growing, "row_count" already
+                // includes the new rows, which don't need to be kept since
+                // they contain junk.
+                for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
 
-        // For each column in the component type to column map, resize
-        // the column.
-        for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
+                        struct Column * col = (struct Column *) table->ct_to_col.values + i;
+                        size_t live_count = table->row_count < col->capacity ? table->row_count : col->capacity;
+                        resize_column(col, capacity, live_count);
+                }
+        }
 
-                struct Column * col = (struct Column *) table->ct_to_col.values + i;
-                resize_column(col, valid_capacity);
+        // The last chunk may hold rows past "MAX_ROW_COUNT", which are
+        // never used.
+        if (capacity > MAX_ROW_COUNT) {
+                capacity = MAX_ROW_COUNT;
         }
+
+        REALLOC(&table->row_idx_to_entity, struct Entity, capacity);
+        table->rows_capacity = capacity;
 }
 
 static void set_row_count(struct CTable * table, size_t count)
 {
+        bool shrinking = count < table->row_count;
         table->row_count = count;
-        if (table->row_count > table->rows_capacity ||
-                table->row_count * ROWS_CAPACITY_MUL <= table->rows_capacity) {
 
-                // Each individual column is resized to change the number
-                // of rows that can be accessed (indices within a column
-                // are indices of rows).
-                set_rows_capacity(table, table->row_count);
+        // Each individual column is resized to change the number of rows
+        // that can be accessed (indices within a column are indices of
+        // rows). The capacity grows geometrically, so that adding a row
+        // only resizes the columns every now and then.
+        if (table->row_count > table->rows_capacity) {
+                set_rows_capacity(table, min_valid_rows_capacity(table->row_count));
+                return;
+        }
+
+        // Tables only shrink when rows are removed, so that a table that's
+        // been cleared keeps its capacity while it's filled again. Neither
+        // do they shrink below the rows reserved for them.
+        if (shrinking && table->row_count * ROWS_SHRINK_DIV <= table->rows_capacity &&
+                table->rows_capacity > table->reserved_rows) {
+
+                size_t capacity = min_valid_rows_capacity(table->row_count * ROWS_CAPACITY_MUL);
+                if (capacity < table->reserved_rows) {
+                        capacity = table->reserved_rows;
+                }
+                set_rows_capacity(table, capacity);
         }
 }
 
-void add_entity_to_table(struct CTable * table, struct Entity entity)
+void reserve_ctable_rows(struct CTable * table, row_idx_t row_count)
 {
-        LOG_DEBUG("Adding " ENTITY_FS " to " CTABLE_FS " ...\n",
-                ENTITY_FA(entity), CTABLE_FA(*table));
-
-        // Add a row with junk data (increment the amount of rows
-        // without initializing the new row that there's now space
-        // for.
-        set_row_count(table, table->row_count + 1);
+        LOG_DEBUG("Reserving %d rows in " CTABLE_FS " ...\n", (int) row_count, CTABLE_FA(*table));
 
-        // Map the index of the new row to "entity".
-        table->row_idx_to_entity[table->row_count - 1] = entity;
-        table->row_idx_skipped[table->row_count - 1] = false;
+        // Same as in "add_entities_to_table".
+        ASSERT(!ctable_being_iterated(table), "Cannot grow " CTABLE_FS " while it's read.",
+                CTABLE_FA(*table));
 
-        // Map the ID of "entity" to the index of the new row.
-        if (entity.id >= table->entity_to_row_size) {
-                // Indices start by 0, so accessing an entity requires
-                // a size of ID + 1.
-                set_entity_to_row_size(table, entity.id + 1);
+        if (row_count > table->reserved_rows) {
+                table->reserved_rows = row_count;
+        }
+        if (row_count > table->rows_capacity) {
+                set_rows_capacity(table, row_count);
         }
-        table->entity_to_row_idx[entity.id] = table->row_count - 1;
 }
 
-static void * get_cell_component(const struct Cell * cell)
+void shrink_ctable(struct CTable * table)
 {
-        // Map the component type of "cell" to a column, and
-        // the entity of "cell" to a row.
-        struct Column * col = get_map_element(&cell->table->ct_to_col, cell->ct.id);
-        row_idx_t row_idx = cell->table->entity_to_row_idx[cell->entity.id];
+        LOG_DEBUG("Shrinking " CTABLE_FS " ...\n", CTABLE_FA(*table));
+
+        ASSERT(!ctable_being_iterated(table), "Cannot shrink " CTABLE_FS " while it's read.",
+                CTABLE_FA(*table));
 
-        // Retrieve a value from that column at the index of the
-        // row.
-        return (byte_t *) col->components + col->component_size * row_idx;
+        table->reserved_rows = 0;
+        if (table->row_count != table->rows_capacity) {
+                set_rows_capacity(table, table->row_count);
+        }
 }
 
-// This function is really just "get_cell_component" except the
-// members of the "Cell" struct are given as parameter so we don't
-// need to expose that struct externally.
-void * get_table_component(const struct CTable * table, struct Entity entity, struct Ct ct)
+void ctable_mem_usage(const struct CTable * table, struct PcecsArctMemStats * stats)
 {
-        struct Cell cell = {
-                .table = table,
-                .entity = entity,
-                .ct = ct
+        const struct Column * cols = table->ct_to_col.values;
+        size_t row_size = 0;
+        size_t cols_reserved = 0;
+        for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
+                row_size += cols[i].component_size;
+                cols_reserved += cols[i].component_size * cols[i].capacity;
+        }
+
+        // Chunked tables have no column buffers, but the list of chunks
+        // is counted as used.
+        size_t chunks_reserved = table->chunk_count * table->chunk_size;
+        size_t chunk_list_size = table->chunk_count * sizeof(byte_t *);
+
+        stats->entity_count = table->row_count;
+        stats->columns = (struct PcecsMemUsage) {
+                .used = table->row_count * row_size + chunk_list_size,
+                .reserved = cols_reserved + chunks_reserved + chunk_list_size
+        };
+        stats->row_entities = (struct PcecsMemUsage) {
+                .used = table->row_count * sizeof(struct Entity),
+                .reserved = table->rows_capacity * sizeof(struct Entity)
         };
+        stats->column_map = map_mem_usage(&table->ct_to_col);
+}
 
-        return get_cell_component(&cell);
+// Points the "struct EntityData" of "entity" to row "row_idx".
+static void set_entity_row(struct Entity entity, row_idx_t row_idx)
+{
+        struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        entity_data->row = row_idx;
 }
 
-static void destroy_cell_component(const struct Cell * cell)
+static row_idx_t entity_row(struct Entity entity)
 {
-        // Get the component destructor, get the actual component, destroy
-        // the component using the destructor.
-        const struct CtData * ct_data = get_map_element(&g_ct_map, cell->ct.id);
+        const struct EntityData * entity_data = get_map_element(&g_entity_map, entity.id);
+        return entity_data->row;
+}
+
+row_idx_t add_entities_to_table(struct CTable * table, const struct Entity * entities, size_t count)
+{
+        LOG_DEBUG("Adding %d entities to " CTABLE_FS " ...\n",
+                (int) count, CTABLE_FA(*table));
+
+        // Growing the table may move its columns under the readers.
+        ASSERT(!ctable_being_iterated(table), "Cannot add rows to " CTABLE_FS " while it's read.",
+                CTABLE_FA(*table));
+
+        // "row_count" and "rows_capacity" would wrap around.
+        ASSERT(count <= (size_t) (MAX_ROW_COUNT - table->row_count),
+                "Cannot add %d entities to " CTABLE_FS "; \"PCECS_ROW_IDX_BITS\" is too small.",
+                (int) count, CTABLE_FA(*table));
+
+        // Add rows with junk data (increment the amount of rows
+        // without initializing the new rows that there's now space
+        // for). The columns are only resized once for all of them.
+        row_idx_t first_row_idx = table->row_count;
+        set_row_count(table, table->row_count + count);
+
+        // Map the indices of the new rows to "entities", and "entities"
+        // to the indices of the new rows.
+        for (size_t i = 0; i < count; ++i) {
+                row_idx_t row_idx = first_row_idx + i;
+                table->row_idx_to_entity[row_idx] = entities[i];
+                set_entity_row(entities[i], row_idx);
+        }
 
-        void * component = get_cell_component(cell);
-        (*ct_data->destructor)(component);
+        return first_row_idx;
 }
 
-static void copy_component(const struct Cell * cell, struct Entity dest_entity)
+row_idx_t add_entity_to_table(struct CTable * table, struct Entity entity)
 {
-        // Construct a destination cell, get components from the source
-        // and the destination, copy the memory from source to destination.
-        struct Cell dest_cell = {
-                .table = cell->table,
-                .ct = cell->ct,
-                .entity = dest_entity
-        };
+        return add_entities_to_table(table, &entity, 1);
+}
 
-        void * src_component = get_cell_component(cell);
-        void * dest_component = get_cell_component(&dest_cell);
+// Returns the component of "col" at row "row_idx" of "table".
+static byte_t * get_col_component(const struct CTable * table, const struct Column * col, row_idx_t row_idx)
+{
+        if (table->rows_per_chunk == 0) {
+                return (byte_t *) col->components + col->component_size * row_idx;
+        }
 
-        struct Column * col = get_map_element(&cell->table->ct_to_col, cell->ct.id);
-        COPY_MEMORY(dest_component, src_component, byte_t, col->component_size);
+        byte_t * chunk = table->chunks[row_idx / table->rows_per_chunk];
+        return chunk + col->chunk_offset + col->component_size * (row_idx % table->rows_per_chunk);
 }
 
-static void destroy_col_component(struct CTable * table, struct Entity entity, map_idx_t col_idx)
+// Returns the number of rows from "row_idx" whose components are stored
+// right after each other in every column of "table", not counting
+// whether the rows are in use.
+static row_idx_t contiguous_row_count(const struct CTable * table, row_idx_t row_idx)
 {
-        struct Ct ct = {
-                .id = table->ct_to_col.index_to_id[col_idx]
-        };
+        if (table->rows_per_chunk == 0) {
+                return ~(row_idx_t) 0 - row_idx;
+        }
+        return table->rows_per_chunk - row_idx % table->rows_per_chunk;
+}
+
+row_idx_t ctable_contiguous_end(const struct CTable * table, row_idx_t row_idx)
+{
+        row_idx_t contiguous_count = contiguous_row_count(table, row_idx);
+        if (contiguous_count >= table->row_count - row_idx) {
+                return table->row_count;
+        }
+        return row_idx + contiguous_count;
+}
+
+// Copies the components of "col" in the "row_count" rows from
+// "src_row_idx" of "src" to the rows from "dest_row_idx" of "dest",
+// whose column "dest_col" must have the same component type. The
+// components are copied in as few pieces as the chunks of the tables
+// allow.
+static void copy_col_components(
+        const struct CTable * dest,
+        const struct Column * dest_col,
+        row_idx_t dest_row_idx,
+        const struct CTable * src,
+        const struct Column * src_col,
+        row_idx_t src_row_idx,
+        row_idx_t row_count)
+{
+        while (row_count > 0) {
+                row_idx_t piece_row_count = row_count;
+                if (contiguous_row_count(dest, dest_row_idx) < piece_row_count) {
+                        piece_row_count = contiguous_row_count(dest, dest_row_idx);
+                }
+                if (contiguous_row_count(src, src_row_idx) < piece_row_count) {
+                        piece_row_count = contiguous_row_count(src, src_row_idx);
+                }
+
+                COPY_MEMORY(get_col_component(dest, dest_col, dest_row_idx),
+                        get_col_component(src, src_col, src_row_idx),
+                        byte_t, src_col->component_size * piece_row_count);
+
+                dest_row_idx += piece_row_count;
+                src_row_idx += piece_row_count;
+                row_count -= piece_row_count;
+        }
+}
 
+static void * get_cell_component(const struct Cell * cell)
+{
+        // Map the component type of "cell" to a column, and retrieve a
+        // value from that column at the index of the row.
+        struct Column * col = get_map_element(&cell->table->ct_to_col, cell->ct.id);
+        return get_col_component(cell->table, col, cell->row);
+}
+
+// This function is really just "get_cell_component" except the
+// members of the "Cell" struct are given as parameter so we don't
+// need to expose that struct externally.
+void * get_table_component(const struct CTable * table, row_idx_t row_idx, struct Ct ct)
+{
         struct Cell cell = {
                 .table = table,
-                .ct = ct,
-                .entity = entity
+                .row = row_idx,
+                .ct = ct
         };
 
-        destroy_cell_component(&cell);
+        return get_cell_component(&cell);
 }
 
-static void copy_table_entity(const struct CTable * table, struct Entity dest, struct Entity src)
+// Destroys the components of the "row_count" rows from "first_row_idx",
+// going through one column at a time.
+static void destroy_rows_components(struct CTable * table, row_idx_t first_row_idx, row_idx_t row_count)
 {
-        // Loop through each column in the table to duplicate each
-        // component of "src" to "dest".
         for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
 
-                struct Ct ct;
-                ct.id = table->ct_to_col.index_to_id[i];
+                const struct CtData * ct_data = get_map_element(&g_ct_map, table->ct_to_col.index_to_id[i]);
 
-                struct Cell src_cell = {
-                        .table = table,
-                        .entity = src,
-                        .ct = ct
-                };
-                copy_component(&src_cell, dest);
+                // Component types created without a destructor don't
+                // need their columns visited at all.
+                if (ct_data->destructor == noop) {
+                        continue;
+                }
+
+                // The components are found once for every run of rows
+                // stored after each other, rather than once per row.
+                const struct Column * col = (struct Column *) table->ct_to_col.values + i;
+                row_idx_t row_idx = first_row_idx;
+                while (row_idx < first_row_idx + row_count) {
+                        row_idx_t piece_end = row_idx + contiguous_row_count(table, row_idx);
+                        if (piece_end > first_row_idx + row_count) {
+                                piece_end = first_row_idx + row_count;
+                        }
+
+                        byte_t * component = get_col_component(table, col, row_idx);
+                        for (; row_idx < piece_end; ++row_idx) {
+                                (*ct_data->destructor)(component);
+                                component += col->component_size;
+                        }
+                }
         }
 }
 
 bool ctable_being_iterated(const struct CTable * table)
 {
-        return table->iterator.id != PCECS_INVALID_ID;
+        return table->reader_count > 0;
 }
 
-static void mark_entity_as_removed(struct CTable * ctable, struct Entity entity, bool destroyed)
+// Removes the "row_count" rows from "first_row_idx" without destroying
+// their components. The hole is filled with the last rows of the table,
+// moved one column at a time.
+static void remove_table_rows(struct CTable * table, row_idx_t first_row_idx, row_idx_t row_count)
 {
-        // Add a tag to skip the entity when iterating.
-        row_idx_t row_idx = ctable->entity_to_row_idx[entity.id];
-        ctable->row_idx_skipped[row_idx] = true;
+        LOG_DEBUG("Removing rows %d to %d from " CTABLE_FS " ...\n",
+                (int) first_row_idx, (int) (first_row_idx + row_count), CTABLE_FA(*table));
+
+        // Removing the rows may partially reorder the table under its
+        // readers.
+        ASSERT(!ctable_being_iterated(table), "Cannot remove rows from " CTABLE_FS " while it's read.",
+                CTABLE_FA(*table));
+
+        ASSERT(first_row_idx + row_count <= table->row_count, "Rows %d to %d are not in " CTABLE_FS ".",
+                (int) first_row_idx, (int) (first_row_idx + row_count), CTABLE_FA(*table));
+
+        // Only as many rows as there are after the removed ones need to
+        // be moved, and no more than the size of the hole. If the removed
+        // rows are the last ones, they're simply dropped.
+        // Rows are moved from the very end of the table, so the rows
+        // moved never overlap the hole they're moved to.
+        row_idx_t rows_after = table->row_count - (first_row_idx + row_count);
+        row_idx_t moved_row_count = rows_after < row_count ? rows_after : row_count;
+        row_idx_t moved_row_idx = table->row_count - moved_row_count;
+
+        if (moved_row_count > 0) {
+                for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
+                        const struct Column * col = (struct Column *) table->ct_to_col.values + i;
+                        copy_col_components(table, col, first_row_idx, table, col, moved_row_idx, moved_row_count);
+                }
 
-        // Add the entity to an "IdPool" to make sure it's properly dealt
-        // with later (not intended as a threat, although 'dealt with'
-        // may in fact refer to murder).
-        if (destroyed) {
-                add_to_id_pool(&ctable->destroyed_entities, entity.id);
-        } else {
-                add_to_id_pool(&ctable->removed_entities, entity.id);
+                // Map the filled rows to the moved entities, and the moved
+                // entities to the filled rows.
+                for (row_idx_t i = 0; i < moved_row_count; ++i) {
+                        struct Entity moved_entity = table->row_idx_to_entity[moved_row_idx + i];
+                        table->row_idx_to_entity[first_row_idx + i] = moved_entity;
+                        set_entity_row(moved_entity, first_row_idx + i);
+                }
         }
+
+        // Drop the last rows, which now either have copies earlier in
+        // the table or were the removed ones.
+        // The "struct EntityData"s of the removed entities still point to
+        // the removed rows, which is up to the caller to fix.
+        set_row_count(table, table->row_count - row_count);
 }
 
-// This routine isn't good, but at least it's documented :)
-static void remove_table_entity(struct CTable * table, struct Entity entity, bool destroy)
+static void remove_table_row(struct CTable * table, row_idx_t row_idx, bool destroy)
 {
-        LOG_DEBUG("Removing " ENTITY_FS " from " CTABLE_FS " ...\n",
-                ENTITY_FA(entity), CTABLE_FA(*table));
-
-        // Removing the entity may partially reorder the table, which
-        // would be difficult to handle while iterating.
-        // Instead, we avoid the problem by instead marking the entity
-        // to be removed later.
-        if (ctable_being_iterated(table)) {
-                mark_entity_as_removed(table, entity, destroy);
-                return;
-        }
-
         if (destroy) {
-                // For each column, destroy the component in that column
-                // belonging to "entity".
-                for (map_idx_t i = 0; i < table->ct_to_col.length; ++i) {
-                        destroy_col_component(table, entity, i);
-                }
+                destroy_rows_components(table, row_idx, 1);
         }
 
-        // Unless the entity to be destroyed is the last entity,
-        // copy the last entity to wherever "entity" is stored.
-        // If "entity" was the last entity and this was done,
-        // memory would be copied to the same location, which
-        // is undefined behaviour.
-        row_idx_t row_idx = table->entity_to_row_idx[entity.id];
-        if (row_idx != table->row_count - 1) {
-                // Copy the last entity in the table to the entity that is being
-                // removed. Now, we have two instances of "last_entity" in the
-                // table, so we can safely remove the last one (which is a lot
-                // easier than removing a row in the middle of the table.
-                struct Entity last_entity = table->row_idx_to_entity[table->row_count - 1];
-                copy_table_entity(table, entity, last_entity);
-
-                // Now that the entity being destroyed is replaced by the last
-                // entity, we can map the index of the destroyed entity to the
-                // previously last entity and map the ID of the previously last
-                // entity to the index of the destroyed one.
-                table->entity_to_row_idx[last_entity.id] = row_idx;
-                table->row_idx_to_entity[row_idx] = last_entity;
-                table->row_idx_skipped[row_idx] = table->row_idx_skipped[table->row_count - 1];
-        }
-
-        // Map the destroyed entity ID to an invalid row index to show
-        // that the entity is no longer there.
-        // We don't need to map the destroyed entity's row index to an
-        // invalid ID, since it's already remapped to the previously
-        // last entity.
-        table->entity_to_row_idx[entity.id] = INVALID_ROW_IDX;
-
-        // Decrease the row count to remove the last entity (the one
-        // that has a copy earlier in the table now) unless "entity"
-        // is the last entity, in which case "entity" is removed.
-        set_row_count(table, table->row_count - 1);
+        remove_table_rows(table, row_idx, 1);
+}
+
+#ifdef ASSERTIONS
+static bool entity_in_table(const struct CTable * table, struct Entity entity)
+{
+        row_idx_t row_idx = entity_row(entity);
+        return row_idx < table->row_count && table->row_idx_to_entity[row_idx].id == entity.id;
 }
+#endif
 
 void destroy_table_entity(struct CTable * table, struct Entity entity)
 {
         LOG_DEBUG("Destroying components of " ENTITY_FS " in " CTABLE_FS " ...\n",
                 ENTITY_FA(entity), CTABLE_FA(*table));
 
+        ASSERT(entity_in_table(table, entity), "No " ENTITY_FS " in " CTABLE_FS ".",
+                ENTITY_FA(entity), CTABLE_FA(*table));
+
         // Remove and destroy.
-        remove_table_entity(table, entity, true);
+        remove_table_row(table, entity_row(entity), true);
 }
 
-#ifdef ASSERTIONS
-static bool entity_in_table(struct CTable * table, struct Entity entity)
+void destroy_table_rows(struct CTable * table, row_idx_t first_row_idx, row_idx_t row_count)
 {
-        // If the table hasn't bothered allocating space for the
-        // ID of "entity", it's not there.
-        if (table->entity_to_row_size <= entity.id) {
-                return false;
-        }
+        LOG_DEBUG("Destroying rows %d to %d of " CTABLE_FS " ...\n",
+                (int) first_row_idx, (int) (first_row_idx + row_count), CTABLE_FA(*table));
 
-        row_idx_t row_idx = table->entity_to_row_idx[entity.id];
+        ASSERT(first_row_idx + row_count <= table->row_count, "Rows %d to %d are not in " CTABLE_FS ".",
+                (int) first_row_idx, (int) (first_row_idx + row_count), CTABLE_FA(*table));
 
-        // Entities not in the table are mapped to invalid row
-        // indices.
-        if (row_idx == INVALID_ROW_IDX) {
-                return false;
-        }
+        destroy_rows_components(table, first_row_idx, row_count);
+        remove_table_rows(table, first_row_idx, row_count);
+}
 
-        // When a row (aka entity) is skipped upon iteration, that
-        // means that the row is removed from the table.
-        if (table->row_idx_skipped[row_idx]) {
-                return false;
-        }
+void clear_ctable(struct CTable * table)
+{
+        LOG_DEBUG("Clearing " CTABLE_FS " ...\n", CTABLE_FA(*table));
+
+        ASSERT(!ctable_being_iterated(table), "Cannot remove rows from " CTABLE_FS " while it's read.",
+                CTABLE_FA(*table));
+
+        destroy_rows_components(table, 0, table->row_count);
 
-        return true;
+        // The storage is kept, since a table that's just been emptied is
+        // likely to be filled again.
+        table->row_count = 0;
 }
-#endif
 
 static void copy_cell_component(struct Cell * dest, struct Cell * src)
 {
@@ -398,25 +622,28 @@ void move_entity(struct CTable * dest, struct CTable * src, struct Entity entity
         ASSERT(entity_in_table(src, entity), "No " ENTITY_FS " in " CTABLE_FS ".",
                 ENTITY_FA(entity), CTABLE_FA(*src));
 
-        ASSERT(!entity_in_table(dest, entity), "Already " ENTITY_FS " in " CTABLE_FS ".",
-                ENTITY_FA(entity), CTABLE_FA(*dest));
+        // "add_entity_to_table" points "entity" to its new row.
+        row_idx_t src_row_idx = entity_row(entity);
 
         // Make space for a new entity in "dest" and move components from
         // "entity" in "src" to that space.
-        add_entity_to_table(dest, entity);
+        row_idx_t dest_row_idx = add_entity_to_table(dest, entity);
         for (map_idx_t i = 0; i < dest->ct_to_col.length; ++i) {
 
                 struct Ct ct;
-                ct.id = dest->ct_to_col.index_to_id[i];
+                ct.id = (ct_id_t) dest->ct_to_col.index_to_id[i];
 
                 if (ct_in_table(src, ct)) {
                         struct Cell src_cell = {
                                 .table = src,
-                                .entity = entity,
+                                .row = src_row_idx,
+                                .ct = ct
+                        };
+                        struct Cell dest_cell = {
+                                .table = dest,
+                                .row = dest_row_idx,
                                 .ct = ct
                         };
-                        struct Cell dest_cell = src_cell;
-                        dest_cell.table = dest;
 
                         copy_cell_component(&dest_cell, &src_cell);
                 }
@@ -424,102 +651,88 @@ void move_entity(struct CTable * dest, struct CTable * src, struct Entity entity
 
         // Remove "entity" from "src", but don't destroy the components
         // since they're now used in "dest".
-        remove_table_entity(src, entity, false);
+        remove_table_row(src, src_row_idx, false);
 }
 
-// Removes all entities whose IDs are in "pool" from "ctable" AND "pool".
-// If "destroy" is "true", destroy their components as well.
-static void remove_ctable_entity_pool(struct CTable * ctable, struct IdPool * pool, bool destroy)
+row_idx_t move_table_rows(struct CTable * dest, struct CTable * src, row_idx_t first_row_idx, row_idx_t row_count)
 {
-        // While there's IDs left in "pool", take an arbitrary ID from
-        // it and remove the entity.
-        while (pool->len > 0) {
-                struct Entity entity;
-                entity.id = steal_from_id_pool(pool);
-                remove_table_entity(ctable, entity, destroy);
-        }
-}
+        LOG_DEBUG("Moving rows %d to %d to " CTABLE_FS " from " CTABLE_FS " ...\n",
+                (int) first_row_idx, (int) (first_row_idx + row_count), CTABLE_FA(*dest), CTABLE_FA(*src));
 
-// Removes the entities in "ctable->removed_entities" and destroys the
-// ones in "destroyed_entities".
-// The function cannot be called while iterating through "ctable", as
-// it may shuffle data around.
-// It must be called between iterations, or some entities might be
-// skipped.
-static void refresh_ctable(struct CTable * ctable)
-{
-        // If no entities were removed or destroyed during the last
-        // iteration, the table needs no refreshing.
-        if (ctable->removed_entities.len == 0 && ctable->destroyed_entities.len == 0) {
-                return;
-        }
+        ASSERT(dest != src, "Cannot move rows of " CTABLE_FS " to itself.", CTABLE_FA(*src));
+
+        ASSERT(first_row_idx + row_count <= src->row_count, "Rows %d to %d are not in " CTABLE_FS ".",
+                (int) first_row_idx, (int) (first_row_idx + row_count), CTABLE_FA(*src));
+
+        // "add_entities_to_table" points the entities to their new rows.
+        const struct Entity * entities = src->row_idx_to_entity + first_row_idx;
+        row_idx_t dest_row_idx = add_entities_to_table(dest, entities, row_count);
+
+        // Copy every column found in both tables all at once.
+        for (map_idx_t i = 0; i < dest->ct_to_col.length; ++i) {
+
+                pcecs_id_t ct_id = dest->ct_to_col.index_to_id[i];
+                if (!map_contains(&src->ct_to_col, ct_id)) {
+                        continue;
+                }
 
-        // Remove "removed_entities" and "destroyed_entities" from "ctable",
-        // destroying the latter.
-        remove_ctable_entity_pool(ctable, &ctable->removed_entities, false);
-        remove_ctable_entity_pool(ctable, &ctable->destroyed_entities, true);
+                const struct Column * dest_col = (struct Column *) dest->ct_to_col.values + i;
+                const struct Column * src_col = get_map_element(&src->ct_to_col, ct_id);
 
-        // Now that the iteration is finished (it must be; otherwise
-        // calling this routine would be illegal), we make sure no
-        // entities are skipped during the new one.
-        // Skipping entities only happen to entities whose index
-        // decreased during the same iteration, so these booleans
-        // should never be true before iteration starts.
-        // That was poorly explained, but then again, it's poorly
-        // designed too so rather than solely blaming explainer-me,
-        // blame designer-me as well.
-        for (row_idx_t i = 0; i < ctable->row_count; ++i) {
-                ctable->row_idx_skipped[i] = false;
+                copy_col_components(dest, dest_col, dest_row_idx, src, src_col, first_row_idx, row_count);
         }
+
+        // Remove the rows from "src", but don't destroy the components
+        // since they're now used in "dest".
+        remove_table_rows(src, first_row_idx, row_count);
+
+        return dest_row_idx;
 }
 
 static struct Entity invalid_entity(void)
 {
         struct Entity entity;
         entity.id = PCECS_INVALID_ID;
+        entity.generation = 0;
         return entity;
 }
 
-struct Entity first_entity_in_ctable(struct CTable * ctable)
+void begin_ctable_read(struct CTable * ctable)
 {
-        ASSERT(ctable->iterator.id == PCECS_INVALID_ID,
-                "Cannot iterate through " CTABLE_FS " as it's already being iterated by "
-                ENTITY_FS ".", CTABLE_FA(*ctable), ENTITY_FA(ctable->iterator));
+        ++ctable->reader_count;
+}
+
+void end_ctable_read(struct CTable * ctable)
+{
+        ASSERT(ctable->reader_count > 0, "No reader of " CTABLE_FS " to end.", CTABLE_FA(*ctable));
+
+        --ctable->reader_count;
+}
 
+struct Entity first_entity_in_ctable(struct CTable * ctable)
+{
         if (ctable->row_count == 0) {
                 return invalid_entity();
         }
 
-        row_idx_t row_idx = ctable->row_count - 1;
-        while (ctable->row_idx_skipped[row_idx]) {
-
-                if (row_idx == 0) {
-                        return invalid_entity();
-                }
-                --row_idx;
-        }
-        ctable->iterator = ctable->row_idx_to_entity[row_idx];
-        return ctable->iterator;
+        begin_ctable_read(ctable);
+        return ctable->row_idx_to_entity[ctable->row_count - 1];
 }
 
 void halt_ctable_iteration(struct CTable * ctable)
 {
-        ctable->iterator.id = PCECS_INVALID_ID;
-        refresh_ctable(ctable);
+        end_ctable_read(ctable);
 }
 
 struct Entity next_entity_in_ctable(struct CTable * ctable, struct Entity curr_entity)
 {
-        ASSERT(ctable->iterator.id == curr_entity.id,
-                "Iterating " CTABLE_FS " from wrong position " ENTITY_FS ".",
+        ASSERT(ctable_being_iterated(ctable),
+                "Iterating " CTABLE_FS " from " ENTITY_FS " without starting the iteration.",
                 CTABLE_FA(*ctable), ENTITY_FA(curr_entity));
 
-        // No need to assert that "curr_entity" is in "ctable", because if
-        // the above assertion is true and "ctable" really is being
-        // iterated from "curr_entity", "curr_entity" sort of has to be in
-        // the table.
-
-        row_idx_t row_idx = ctable->entity_to_row_idx[curr_entity.id];
+        // No rows move while the table is read, so the row of
+        // "curr_entity" is still where the iteration is.
+        row_idx_t row_idx = entity_row(curr_entity);
 
         // If done iterating.
         if (row_idx == 0) {
@@ -527,16 +740,5 @@ struct Entity next_entity_in_ctable(struct CTable * ctable, struct Entity curr_e
                 return invalid_entity();
         }
 
-        row_idx_t new_row_idx = row_idx - 1;
-        while (ctable->row_idx_skipped[new_row_idx]) {
-                if (new_row_idx == 0) {
-                        halt_ctable_iteration(ctable);
-                        return invalid_entity();
-                }
-
-                --new_row_idx;
-        }
-
-        ctable->iterator = ctable->row_idx_to_entity[new_row_idx];
-        return ctable->iterator;
+        return ctable->row_idx_to_entity[row_idx - 1];
 }
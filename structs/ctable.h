@@ -1,24 +1,42 @@
 // Table that organizes the components of entities belonging to the
 // same archetype.
-// The table maps component types to columns, and entities are mapped
-// to indices within those columns (rows, in other words).
+// The table maps component types to columns, and rows (indices within
+// those columns) to entities. Entities are mapped to their rows by their
+// "struct EntityData", which the table keeps up to date as rows move.
 
 #ifndef CTABLE_H
 #define CTABLE_H
 
 #include "column.h"
+#include "../tools/byte.h"
 #include "../interface/ct_set.h"
 #include "../interface/entity.h"
 #include "../ids/id_pool.h"
 #include "map.h"
 
-#define CTABLE_FS "component table (%d, %d)"
-#define CTABLE_FA(table) (table).ct_to_col.length, (table).row_count
+#define CTABLE_FS "component table (" MAP_IDX_FS ", " ROW_IDX_FS ")"
+#define CTABLE_FA(table) MAP_IDX_FA((table).ct_to_col.length), ROW_IDX_FA((table).row_count)
 
-// The maximum possible amount of rows cannot be more than the
-// maximum amount of entities, which cannot be more than the maximum
-// amount of unique IDs.
-typedef pcecs_id_t row_idx_t;
+// The width of row indices, in bits (see "PCECS_ID_BITS"). A table
+// can't have more rows than there are entities, so it's never useful
+// for it to be greater than "PCECS_ID_BITS". It may be smaller if no
+// archetype ever holds more than "MAX_ROW_COUNT" entities, which
+// "add_entities_to_table" asserts.
+#ifndef PCECS_ROW_IDX_BITS
+#define PCECS_ROW_IDX_BITS PCECS_ID_BITS
+#endif
+
+typedef UINT_OF_BITS(PCECS_ROW_IDX_BITS) row_idx_t;
+
+#define ROW_IDX_FS "%" PRIU_OF_BITS(PCECS_ROW_IDX_BITS)
+#define ROW_IDX_FA(row_idx) (row_idx_t) (row_idx)
+
+// Never a valid row.
+#define INVALID_ROW_IDX MAX_OF_UINT(row_idx_t)
+
+// The greatest number of rows a table can have, so that every index is
+// below "INVALID_ROW_IDX".
+#define MAX_ROW_COUNT ((row_idx_t) (INVALID_ROW_IDX - 1))
 
 struct CTable {
         // Map component type IDs to "struct Column"s.
@@ -26,63 +44,139 @@ struct CTable {
 
         row_idx_t row_count;
 
-        row_idx_t * entity_to_row_idx;
-        row_idx_t entity_to_row_size;
-
         struct Entity * row_idx_to_entity;
+        // The number of rows there's room for in "row_idx_to_entity" and
+        // every column.
         row_idx_t rows_capacity;
-
-        // When we want to destroy, remove or move elements of a component
-        // table while iterating through it (id est when we're executing a
-        // system), "row_idx_skipped" will be used to know which elements
-        // are no longer in the table, and should therefore not be iterated.
-        // "removed_entities" is an unordered set of entity IDs that are
-        // supposed to be removed from the "CTable", which is done after the
-        // iteration is finished.
-        // "destroyed_entities" are the entities that should be removed AND
-        // destroyed.
-        // Adding entities to the table doesn't impose such difficulties as
-        // they're simply appended to the end, so the worst thing that can
-        // happen is that they get skipped the first iteration they're in
-        // the table.
-        // Iteration happens bakcwards! Noitareti!
-        bool * row_idx_skipped;
-        struct IdPool removed_entities;
-        struct IdPool destroyed_entities;
-
-        // If the table is being iterated through, this entity is the one
-        // currently being iterated.
-        // If the table is not being iterated through, "iterator"'s ID ==
-        // "PCECS_INVALID_ID".
-        struct Entity iterator;
+        // The capacity never shrinks below this many rows on its own
+        // (see "reserve_ctable_rows").
+        row_idx_t reserved_rows;
+
+        // If not 0, the components aren't stored in one buffer per
+        // column, but in chunks that each hold "rows_per_chunk" rows of
+        // every column (see "set_ctable_chunk_size"). Row "i" is in
+        // chunk "i / rows_per_chunk", and the components of a column
+        // start at the "chunk_offset" of the column within every chunk.
+        row_idx_t rows_per_chunk;
+        byte_t ** chunks;
+        size_t chunk_count;
+        // The size and alignment of every chunk, in bytes.
+        size_t chunk_size;
+        size_t chunk_alignment;
+
+        // The number of iterations (see "first_entity_in_ctable") and
+        // batches (see "begin_ctable_read") currently reading the table.
+        // Any number of them may read the table at once, for instance one
+        // batch for every range of rows handed to a thread.
+        // Rows cannot be added or removed while the table is read, since
+        // the readers point directly into the columns. Structural changes
+        // made by systems are recorded in command buffers instead, and
+        // applied once the systems are done (see "deferred_cmds.h").
+        size_t reader_count;
 };
 
+// Makes the tables created from now on store their components in chunks
+// of about "chunk_size" bytes, each holding the same rows of every
+// column, or in one buffer per column if "chunk_size" is 0 (which is
+// the default).
+// Chunked tables grow by allocating another chunk rather than resizing
+// every column, so their components never move unless their rows are
+// removed or moved to another table. They're read in batches that never
+// cross the end of a chunk (see "ctable_contiguous_end").
+void set_ctable_chunk_size(size_t chunk_size);
+
 // Create a new component table with all the component types in "cts",
 // but no entities.
 struct CTable create_ctable(const struct CtSet * cts);
 
+// Frees the storage of "table", which must have no rows and no readers.
+void destroy_ctable(struct CTable * table);
+
 // Add "entity" to table, provided that "entity" belongs to "table"'s
-// archetype.
+// archetype, and return its new row. The "struct EntityData" of
+// "entity" must exist, and is pointed to the new row.
 // "entity"'s components will contain junk data.
-void add_entity_to_table(struct CTable * table, struct Entity entity);
+// Cannot be called while "table" is read.
+row_idx_t add_entity_to_table(struct CTable * table, struct Entity entity);
+
+// Same as "add_entity_to_table", but adds all "count" entities of
+// "entities" to consecutive rows, growing "table" only once. Returns
+// the row of the first entity.
+row_idx_t add_entities_to_table(struct CTable * table, const struct Entity * entities, size_t count);
+
+// Moves the "row_count" rows from "first_row_idx" of "src" to the end
+// of "dest", one column at a time, and returns the row of the first
+// moved entity in "dest". The "struct EntityData"s of the moved entities
+// are pointed to their new rows (but not their new archetype), and so
+// are the ones of the entities filling the hole left in "src".
+// Components of types not in "dest" are dropped without being destroyed,
+// the same as in "move_entity". Neither table can be read while doing so.
+row_idx_t move_table_rows(struct CTable * dest, struct CTable * src, row_idx_t first_row_idx, row_idx_t row_count);
+
+// Get the component of type "ct" at row "row_idx" of "table".
+void * get_table_component(const struct CTable * table, row_idx_t row_idx, struct Ct ct);
+
+// Makes room for at least "row_count" rows in "table", and keeps it from
+// shrinking below that until "shrink_ctable" is called.
+// Cannot be called while "table" is read.
+void reserve_ctable_rows(struct CTable * table, row_idx_t row_count);
+
+// Shrinks the capacity of "table" to its row count (or the fewest whole
+// chunks holding them), and forgets the rows reserved for it.
+// Cannot be called while "table" is read.
+void shrink_ctable(struct CTable * table);
+
+// Sets the "entity_count", "columns", "row_entities" and "column_map" of
+// "stats" to those of "table".
+void ctable_mem_usage(const struct CTable * table, struct PcecsArctMemStats * stats);
+
+// Returns the end of the run of rows from "row_idx" whose components
+// are stored right after each other in every column of "table". That's
+// "row_count" for tables with one buffer per column, or the end of the
+// chunk of "row_idx" if it comes first.
+row_idx_t ctable_contiguous_end(const struct CTable * table, row_idx_t row_idx);
+
+// Returns "true" iff "table" has at least one reader, that is, it's
+// being iterated through using "first_entity_in_ctable" and
+// "next_entity_in_ctable", or batches of it are being handed out (see
+// "begin_ctable_read").
+bool ctable_being_iterated(const struct CTable * table);
 
-// Get the component belonging to "entity" of type "ct", provided
-// "entity" is in "table".
-void * get_table_component(const struct CTable * table, struct Entity entity, struct Ct ct);
+// Adds a reader to "table", which may not get or lose rows until the
+// last reader is done. Several readers may read the same table at
+// once, but they must be added and ended on the same thread.
+void begin_ctable_read(struct CTable * table);
 
-// Returns "true" iff "table" is being iterated through using
-// "first_entity_in_ctable" and "next_entity_in_ctable".
-bool ctable_being_iterated(const struct CTable * table);
+// Ends a read started by "begin_ctable_read".
+void end_ctable_read(struct CTable * table);
 
 // Destroy "entity"'s components and remove it from "table".
+// The "struct EntityData" of the entity moved to the row of "entity" is
+// updated, while the one of "entity" is left for the caller to destroy.
+// Cannot be called while "table" is read.
 void destroy_table_entity(struct CTable * table, struct Entity entity);
 
+// Destroys the components of the "row_count" rows from "first_row_idx"
+// and removes the rows from "table", destroying one column at a time.
+// The "struct EntityData"s of the entities moved to the removed rows are
+// updated, while the ones of the removed entities are left for the
+// caller to destroy. Cannot be called while "table" is read.
+void destroy_table_rows(struct CTable * table, row_idx_t first_row_idx, row_idx_t row_count);
+
+// Destroys the components of every row in "table" and removes the rows
+// without freeing the storage. Same as for "destroy_table_rows", the
+// "struct EntityData"s of the entities are left for the caller to destroy.
+void clear_ctable(struct CTable * table);
+
 // Copy "entity" and its components from "src" to "dest" and remove
-// it from "src".
+// it from "src", pointing its "struct EntityData" to its new row (but
+// not its new archetype). Neither table can be read while doing so.
 void move_entity(struct CTable * dest, struct CTable * src, struct Entity entity);
 
 // Get an arbitrary "first" entity in "ctable". Use together with
 // "next_entity_in_ctable" to iterate through a "CTable".
+// The iteration is a reader of "ctable" (see "begin_ctable_read")
+// until it reaches the end or is halted.
 struct Entity first_entity_in_ctable(struct CTable * ctable);
 
 // Can only be called if "ctable" is currently being iterated through.
@@ -93,8 +187,8 @@ void halt_ctable_iteration(struct CTable * ctable);
 // Get an arbitrary 'next' entity in "ctable", 'after' "curr_entity".
 // Returns an entity with ID == "PCECS_INVALID_ID" if the end is
 // reached.
-// "CTables" can only be iterated through by one source at a time,
-// and the whole table must be iterated.
+// Several iterations of the same "CTable" may be going on at once,
+// but each of them must either reach the end or be halted.
 struct Entity next_entity_in_ctable(struct CTable * ctable, struct Entity curr_entity);
 
 #endif
@@ -0,0 +1,71 @@
+#include "deferred_cmds.h"
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+
+#define MEM_TAG MEM_TAG_CMD_BUF
+
+static struct CmdBuf * g_cmd_bufs = NULL;
+static size_t g_thread_count = 0;
+static size_t g_deferral_depth = 0;
+
+// The buffer of the calling thread, or NULL if it isn't deferring.
+// Worker threads keep theirs after the deferral ends, but they only
+// record anything while running systems, which only happens during
+// deferrals.
+static _Thread_local struct CmdBuf * t_cmd_buf = NULL;
+
+void set_deferred_cmd_thread_count(size_t thread_count)
+{
+        ASSERT(g_deferral_depth == 0, "Cannot change the thread count while deferring commands.");
+
+        for (size_t i = 0; i < g_thread_count; ++i) {
+                destroy_cmd_buf(&g_cmd_bufs[i]);
+        }
+
+        REALLOC(&g_cmd_bufs, struct CmdBuf, thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+                g_cmd_bufs[i] = create_cmd_buf();
+        }
+        g_thread_count = thread_count;
+}
+
+void begin_deferring_cmds(void)
+{
+        if (g_thread_count == 0) {
+                set_deferred_cmd_thread_count(1);
+        }
+
+        if (g_deferral_depth == 0) {
+                t_cmd_buf = &g_cmd_bufs[0];
+        }
+        ++g_deferral_depth;
+}
+
+void end_deferring_cmds(void)
+{
+        ASSERT(g_deferral_depth > 0, "Not deferring commands.");
+
+        --g_deferral_depth;
+        if (g_deferral_depth > 0) {
+                return;
+        }
+        t_cmd_buf = NULL;
+
+        // Applying the buffers starts a new deferral for the changes made
+        // by start and destroy functions, which is applied before
+        // returning, so every buffer is empty afterwards.
+        apply_cmd_bufs(g_cmd_bufs, g_thread_count);
+}
+
+void defer_cmds_on_thread(size_t thread_idx)
+{
+        ASSERT(g_deferral_depth > 0 && thread_idx < g_thread_count,
+                "Cannot defer commands on thread %d.", (int) thread_idx);
+
+        t_cmd_buf = &g_cmd_bufs[thread_idx];
+}
+
+struct CmdBuf * deferred_cmd_buf(void)
+{
+        return t_cmd_buf;
+}
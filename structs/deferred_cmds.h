@@ -0,0 +1,39 @@
+// Structural changes (see "cmd_buf.h") made while systems run are
+// recorded in command buffers rather than carried out at once, since
+// the systems read the tables the changes would reorder.
+// Every thread running systems records to its own buffer, so threads
+// never share a buffer. The buffers are applied together when the
+// outermost deferral ends, which is the sync point of every system
+// execution.
+
+#ifndef DEFERRED_CMDS_H
+#define DEFERRED_CMDS_H
+
+#include <stddef.h>
+#include "../interface/cmd_buf.h"
+
+// Sets the number of threads that may record changes at once, which is
+// the number of threads running systems. Buffer 0 belongs to the thread
+// calling "begin_deferring_cmds".
+// Cannot be called while deferring.
+void set_deferred_cmd_thread_count(size_t thread_count);
+
+// Starts deferring the structural changes made on the calling thread.
+// Deferrals nest, so only the outermost "end_deferring_cmds" applies
+// the changes.
+void begin_deferring_cmds(void);
+
+// Ends a deferral started by "begin_deferring_cmds". If it's the
+// outermost one, the buffers of every thread are applied.
+void end_deferring_cmds(void);
+
+// Makes the calling thread record its changes to buffer "thread_idx"
+// until the outermost deferral ends. Used by threads running systems
+// on behalf of the thread that began deferring.
+void defer_cmds_on_thread(size_t thread_idx);
+
+// Returns the buffer that changes made by the calling thread should be
+// recorded to, or NULL if they should be carried out at once.
+struct CmdBuf * deferred_cmd_buf(void);
+
+#endif
@@ -6,7 +6,9 @@ struct EntityData create_entity_data(struct Arct arct)
         LOG_DEBUG("Creating entity data from " ARCT_FS " ...\n", ARCT_FA(arct));
 
         struct EntityData entity_data = {
-                .arct = arct
+                .arct = arct,
+                // Set by the table once the entity is added to it.
+                .row = INVALID_ROW_IDX
         };
 
         LOG_DEBUG("Created " ENTITY_DATA_FS ".\n", ENTITY_DATA_FA(entity_data));
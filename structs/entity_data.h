@@ -7,17 +7,23 @@
 #define ENTITY_DATA_H
 
 #include "arct.h"
+#include "ctable.h"
 
-#define ENTITY_DATA_FS "entity data (" ARCT_FS ")"
-#define ENTITY_DATA_FA(entity_data) ARCT_FA((entity_data).arct)
+#define ENTITY_DATA_FS "entity data (" ARCT_FS ", row " ROW_IDX_FS ")"
+#define ENTITY_DATA_FA(entity_data) ARCT_FA((entity_data).arct), ROW_IDX_FA((entity_data).row)
 
 struct EntityData {
         // The archetype that the entity belongs to, that is, what combination
         // of component types it contains.
         struct Arct arct;
+        // The row of the entity in the table of "arct". Kept up to date
+        // by the table whenever the entity is added, moved or another
+        // entity takes its place.
+        row_idx_t row;
 };
 
-// Create and initialize an "EntityData" struct.
+// Create and initialize an "EntityData" struct. The row is set once
+// the entity is added to the table of "arct".
 struct EntityData create_entity_data(struct Arct arct);
 
 // Free resources allocated by "entity_data".
@@ -0,0 +1,91 @@
+#include "entity_gens.h"
+#include "../tools/mem_tools.h"
+#include "../tools/log.h"
+
+#define MEM_TAG MEM_TAG_ENTITY
+
+#define ENTITY_GENS_CAPACITY_MUL 2
+
+// Set in the generation of every ID without a living entity. Entities
+// never have it set, so comparing the generation of an entity to the
+// generation of its ID is enough to tell if it's alive. While the bit
+// is set, the rest of the generation is the one the next entity with
+// the ID gets.
+#define DEAD_GEN_BIT ((entity_gen_t) ((entity_gen_t) 1 << (PCECS_ENTITY_GEN_BITS - 1)))
+
+// "g_entity_gens[i]" is the generation of ID "i". IDs beyond
+// "g_entity_gen_count" have never been alive, and have generation
+// "DEAD_GEN_BIT".
+static entity_gen_t * g_entity_gens = NULL;
+static size_t g_entity_gen_count = 0;
+static size_t g_entity_gens_capacity = 0;
+
+static entity_gen_t entity_gen(pcecs_id_t id)
+{
+        return id < g_entity_gen_count ? g_entity_gens[id] : DEAD_GEN_BIT;
+}
+
+// Grows the list of generations to fit "id", which is amortized so that
+// ever greater IDs don't reallocate every time.
+static void fit_entity_gen(pcecs_id_t id)
+{
+        if (id < g_entity_gen_count) {
+                return;
+        }
+
+        if (id >= g_entity_gens_capacity) {
+                size_t capacity = g_entity_gens_capacity * ENTITY_GENS_CAPACITY_MUL;
+                if (capacity <= id) {
+                        capacity = (size_t) id + 1;
+                }
+                REALLOC(&g_entity_gens, entity_gen_t, capacity);
+                g_entity_gens_capacity = capacity;
+        }
+
+        for (size_t i = g_entity_gen_count; i <= id; ++i) {
+                g_entity_gens[i] = DEAD_GEN_BIT;
+        }
+        g_entity_gen_count = (size_t) id + 1;
+}
+
+struct Entity entity_of_id(pcecs_id_t id)
+{
+        return (struct Entity) {
+                .id = id,
+                .generation = (entity_gen_t) (entity_gen(id) & ~DEAD_GEN_BIT)
+        };
+}
+
+void revive_entity_gen(struct Entity entity)
+{
+        ASSERT(entity_gen(entity.id) == (entity_gen_t) (entity.generation | DEAD_GEN_BIT),
+                "Cannot revive " ENTITY_FS ", since its ID is alive or has another generation.",
+                ENTITY_FA(entity));
+
+        fit_entity_gen(entity.id);
+        g_entity_gens[entity.id] = entity.generation;
+}
+
+void kill_entity_gen(pcecs_id_t id)
+{
+        fit_entity_gen(id);
+
+        // The generation wraps around rather than overflowing into
+        // "DEAD_GEN_BIT". A handle kept through that many reuses of its
+        // ID is considered alive again.
+        entity_gen_t next_gen = (entity_gen_t) (((g_entity_gens[id] & ~DEAD_GEN_BIT) + 1) & ~DEAD_GEN_BIT);
+        g_entity_gens[id] = (entity_gen_t) (next_gen | DEAD_GEN_BIT);
+}
+
+bool entity_gen_alive(struct Entity entity)
+{
+        return entity.id < g_entity_gen_count && g_entity_gens[entity.id] == entity.generation;
+}
+
+struct PcecsMemUsage entity_gens_mem_usage(void)
+{
+        return (struct PcecsMemUsage) {
+                .used = g_entity_gen_count * sizeof(entity_gen_t),
+                .reserved = g_entity_gens_capacity * sizeof(entity_gen_t)
+        };
+}
@@ -0,0 +1,35 @@
+// The generation of every entity ID. The generation of an ID is bumped
+// whenever the entity with that ID is destroyed, so a "struct Entity"
+// of a destroyed entity never matches the entity that reuses its ID.
+// The generations are kept in one list indexed by ID, so checking if an
+// entity is alive doesn't involve any map.
+
+#ifndef ENTITY_GENS_H
+#define ENTITY_GENS_H
+
+#include <stdbool.h>
+#include "../interface/entity.h"
+#include "../interface/mem_stats.h"
+
+// Returns the entity with ID "id" if it's alive. Otherwise, returns the
+// entity that will be created next with "id".
+// Must not be called while the generation of "id" may change, but can
+// be called from any thread running systems.
+struct Entity entity_of_id(pcecs_id_t id);
+
+// Marks "entity", returned by "entity_of_id" while it wasn't alive, as
+// alive.
+void revive_entity_gen(struct Entity entity);
+
+// Marks the entity with ID "id" as destroyed, even if it was never
+// alive, so that no entity given out with "id" so far will match the
+// next entity created with it.
+void kill_entity_gen(pcecs_id_t id);
+
+// Returns "true" iff "entity" is alive.
+bool entity_gen_alive(struct Entity entity);
+
+// The memory allocated for the generations.
+struct PcecsMemUsage entity_gens_mem_usage(void);
+
+#endif
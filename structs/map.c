@@ -2,22 +2,21 @@
 #include "../tools/mem_tools.h"
 #include "../tools/byte.h"
 
-// Assuming integer types where all bits are 1 are:
-// *    Valid
-// *    Either very large or negative.
-#define INVALID_MAP_IDX (~((map_idx_t) 0))
+#define MEM_TAG MEM_TAG_MAP
 
 #define VALS_CAPACITY_MUL 2
 
 // The minimum valid capacity for the values stored in a map greater
-// than or equal to "req_capacity".
-static map_idx_t min_valid_values_capacity(map_idx_t req_capacity)
+// than or equal to "req_capacity", which can't be greater than
+// "MAX_MAP_LENGTH". Computed in "size_t", since doubling a narrow
+// "map_idx_t" could wrap around to 0.
+static map_idx_t min_valid_values_capacity(size_t req_capacity)
 {
-        map_idx_t capacity = 1;
+        size_t capacity = 1;
         while (capacity < req_capacity) {
                 capacity *= VALS_CAPACITY_MUL;
         }
-        return capacity;
+        return (map_idx_t) (capacity < MAX_MAP_LENGTH ? capacity : MAX_MAP_LENGTH);
 }
 
 static void noop(void * arg)
@@ -50,10 +49,30 @@ struct Map create_map(size_t value_size, void (* value_destructor)(void * value)
         // the map without being destroyed.
         map.value_destructor = value_destructor ? value_destructor : noop;
 
+        map.id_page_size = 0;
+        map.id_page_shift = 0;
+        map.id_pages = NULL;
+        map.id_page_lengths = NULL;
+        map.id_page_count = 0;
+
         LOG_DEBUG("Created " MAP_FS ".\n", MAP_FA(map));
         return map;
 }
 
+struct Map create_paged_map(size_t value_size, void (* value_destructor)(void * value),
+        size_t id_page_size)
+{
+        ASSERT(id_page_size != 0 && (id_page_size & (id_page_size - 1)) == 0,
+                "Page size %d of map is not a power of two.", (int) id_page_size);
+
+        struct Map map = create_map(value_size, value_destructor);
+        map.id_page_size = id_page_size;
+        while (((size_t) 1 << map.id_page_shift) < id_page_size) {
+                ++map.id_page_shift;
+        }
+        return map;
+}
+
 #ifdef ASSERTIONS
         static void validate_map(const struct Map * map)
         {
@@ -70,26 +89,44 @@ void destroy_map(struct Map * map)
         LOG_DEBUG("Destroying " MAP_FS " ...\n", MAP_FA(*map));
 
         // Destroy each value.
-        for (int i = 0; i < map->length; ++i) {
+        for (map_idx_t i = 0; i < map->length; ++i) {
                 void * value = (byte_t *) map->values + map->value_size * i;
                 map->value_destructor(value);
         }
         // Free resources.
+        for (size_t i = 0; i < map->id_page_count; ++i) {
+                FREE(map->id_pages[i]);
+        }
+        FREE(map->id_pages);
+        FREE(map->id_page_lengths);
         FREE(map->id_to_index);
         FREE(map->index_to_id);
         FREE(map->values);
 }
 
-bool map_contains(const struct Map * map, pcecs_id_t id)
+// Where the index of "id" is kept, or NULL if there's no room for it
+// because no ID near it has been added.
+static map_idx_t * find_id_index(const struct Map * map, pcecs_id_t id)
 {
-        // IDs in "map" are guaranteed to be between 0 and "id_to_index_size" - 1,
-        // so an ID greater than that is not in the map.
-        if (id >= map->id_to_index_size) {
-                return false;
+        if (map->id_page_size == 0) {
+                // IDs in "map" are guaranteed to be between 0 and
+                // "id_to_index_size" - 1, so an ID greater than that is not
+                // in the map.
+                return id < map->id_to_index_size ? &map->id_to_index[id] : NULL;
         }
 
+        size_t page = id >> map->id_page_shift;
+        if (page >= map->id_page_count || map->id_pages[page] == NULL) {
+                return NULL;
+        }
+        return &map->id_pages[page][id & (map->id_page_size - 1)];
+}
+
+bool map_contains(const struct Map * map, pcecs_id_t id)
+{
         // Return whether "id" is marked as unused.
-        return map->id_to_index[id] != INVALID_MAP_IDX;
+        const map_idx_t * index = find_id_index(map, id);
+        return index != NULL && *index != INVALID_MAP_IDX;
 }
 
 void * get_map_element_nullable(const struct Map * map, pcecs_id_t id)
@@ -100,7 +137,7 @@ void * get_map_element_nullable(const struct Map * map, pcecs_id_t id)
                 return NULL;
         }
 
-        size_t index = map->id_to_index[id];
+        size_t index = *find_id_index(map, id);
         // The offset from the beginning of map->values equals the index times
         // the size of a single map element.
         // "sizeof(void)" not standard, so "byte_t"s are used for arithmetics.
@@ -131,7 +168,56 @@ static void resize_id_to_index(struct Map * map, size_t size)
         map->id_to_index_size = size;
 }
 
-static void set_values_capacity(struct Map * map, map_idx_t capacity)
+// Makes room for the index of "id" and returns where it's kept.
+static map_idx_t * add_id_index(struct Map * map, pcecs_id_t id)
+{
+        if (map->id_page_size == 0) {
+                if (map->id_to_index_size <= id) {
+                        resize_id_to_index(map, id + 1);
+                }
+                return &map->id_to_index[id];
+        }
+
+        size_t page = id >> map->id_page_shift;
+        if (page >= map->id_page_count) {
+                REALLOC(&map->id_pages, map_idx_t *, page + 1);
+                REALLOC(&map->id_page_lengths, map_idx_t, page + 1);
+                for (size_t i = map->id_page_count; i <= page; ++i) {
+                        map->id_pages[i] = NULL;
+                        map->id_page_lengths[i] = 0;
+                }
+                map->id_page_count = page + 1;
+        }
+
+        if (map->id_pages[page] == NULL) {
+                map->id_pages[page] = ALLOC(map_idx_t, map->id_page_size);
+                for (size_t i = 0; i < map->id_page_size; ++i) {
+                        map->id_pages[page][i] = INVALID_MAP_IDX;
+                }
+        }
+
+        ++map->id_page_lengths[page];
+        return &map->id_pages[page][id & (map->id_page_size - 1)];
+}
+
+// Marks "id" as unused by "map", freeing its page if it was the last ID
+// in it.
+static void remove_id_index(struct Map * map, pcecs_id_t id)
+{
+        *find_id_index(map, id) = INVALID_MAP_IDX;
+
+        if (map->id_page_size == 0) {
+                return;
+        }
+
+        size_t page = id >> map->id_page_shift;
+        if (--map->id_page_lengths[page] == 0) {
+                FREE(map->id_pages[page]);
+                map->id_pages[page] = NULL;
+        }
+}
+
+static void set_values_capacity(struct Map * map, size_t capacity)
 {
         map_idx_t valid_capacity = min_valid_values_capacity(capacity);
 
@@ -148,7 +234,7 @@ static void set_map_length(struct Map * map, map_idx_t length)
         // Reallocate if "length" is too large (or way too little) for
         // the capacity of "map".
         if (length > map->values_capacity ||
-                length * VALS_CAPACITY_MUL <= map->values_capacity) {
+                (size_t) length * VALS_CAPACITY_MUL <= map->values_capacity) {
 
                 set_values_capacity(map, length);
         }
@@ -163,9 +249,10 @@ void add_to_map(struct Map * map, pcecs_id_t id, void * value)
                 "Cannot add " PCECS_ID_FS " to " MAP_FS " as it's already there.",
                 PCECS_ID_FA(id), MAP_FA(*map));
 
-        if (map->id_to_index_size <= id) {
-                resize_id_to_index(map, id + 1);
-        }
+        ASSERT(map->length < MAX_MAP_LENGTH, "Cannot add " PCECS_ID_FS " to full " MAP_FS
+                "; \"PCECS_MAP_IDX_BITS\" is too small.", PCECS_ID_FA(id), MAP_FA(*map));
+
+        map_idx_t * index = add_id_index(map, id);
 
         set_map_length(map, map->length + 1);
 
@@ -175,7 +262,7 @@ void add_to_map(struct Map * map, pcecs_id_t id, void * value)
 
         // Map the last element of "map" to "id" and vice versa.
         map->index_to_id[map->length - 1] = id;
-        map->id_to_index[id] = map->length - 1;
+        *index = map->length - 1;
 }
 
 void remove_from_map(struct Map * map, pcecs_id_t id)
@@ -187,12 +274,12 @@ void remove_from_map(struct Map * map, pcecs_id_t id)
                 PCECS_ID_FA(id), MAP_FA(*map));
 
         // Destroy the value belonging to "id".
-        map_idx_t destroyed_index = map->id_to_index[id];
+        map_idx_t destroyed_index = *find_id_index(map, id);
         void * destroyed_value = (byte_t *) map->values + map->value_size * destroyed_index;
         map->value_destructor(destroyed_value);
 
         // Mark "id" as unused by the map.
-        map->id_to_index[id] = INVALID_MAP_IDX;
+        remove_id_index(map, id);
 
         // Unless the destroyed element is the last value in "map", move
         // the last value to where the destroyed element was and remap
@@ -203,7 +290,7 @@ void remove_from_map(struct Map * map, pcecs_id_t id)
                 COPY_MEMORY(destroyed_value, last_value, byte_t, map->value_size);
 
                 pcecs_id_t last_value_id = map->index_to_id[map->length - 1];
-                map->id_to_index[last_value_id] = destroyed_index;
+                *find_id_index(map, last_value_id) = destroyed_index;
                 map->index_to_id[destroyed_index] = last_value_id;
         }
 
@@ -211,3 +298,22 @@ void remove_from_map(struct Map * map, pcecs_id_t id)
         // index, remove the last copy of it.
         set_map_length(map, map->length - 1);
 }
+
+struct PcecsMemUsage map_mem_usage(const struct Map * map)
+{
+        // The list of pages counts as used.
+        size_t pages_size = map->id_page_count * (sizeof(map_idx_t *) + sizeof(map_idx_t));
+        for (size_t i = 0; i < map->id_page_count; ++i) {
+                if (map->id_pages[i]) {
+                        pages_size += map->id_page_size * sizeof(map_idx_t);
+                }
+        }
+
+        size_t entry_size = sizeof(map_idx_t) + sizeof(pcecs_id_t) + map->value_size;
+        return (struct PcecsMemUsage) {
+                .used = map->length * entry_size
+                        + map->id_page_count * (sizeof(map_idx_t *) + sizeof(map_idx_t)),
+                .reserved = map->id_to_index_size * sizeof(map_idx_t) + pages_size
+                        + map->values_capacity * (sizeof(pcecs_id_t) + map->value_size)
+        };
+}
@@ -8,16 +8,57 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "../ids/id.h"
+#include "../interface/mem_stats.h"
 
-#define MAP_FS "map (%d elements)"
-#define MAP_FA(map) (map).length
+#define MAP_FS "map (" MAP_IDX_FS " elements)"
+#define MAP_FA(map) MAP_IDX_FA((map).length)
 
-typedef unsigned int map_idx_t;
+// The width of indices in maps, in bits (see "PCECS_ID_BITS"). Maps
+// can't have more elements than there are IDs, so it's never useful
+// for it to be greater than "PCECS_ID_BITS".
+#ifndef PCECS_MAP_IDX_BITS
+#define PCECS_MAP_IDX_BITS PCECS_ID_BITS
+#endif
+
+typedef UINT_OF_BITS(PCECS_MAP_IDX_BITS) map_idx_t;
+
+#define MAP_IDX_FS "%" PRIU_OF_BITS(PCECS_MAP_IDX_BITS)
+#define MAP_IDX_FA(map_idx) (map_idx_t) (map_idx)
+
+// Marks IDs that aren't in a map.
+#define INVALID_MAP_IDX MAX_OF_UINT(map_idx_t)
+
+// The greatest number of elements a map can hold, so that every index is
+// below "INVALID_MAP_IDX".
+#define MAX_MAP_LENGTH ((map_idx_t) (INVALID_MAP_IDX - 1))
+
+// Good page sizes for paged maps (see "create_paged_map"). Maps of
+// entities hold many IDs spread over a large range, while maps of
+// component types are small and many.
+#define ENTITY_MAP_PAGE_SIZE 1024
+#define CT_MAP_PAGE_SIZE 64
 
 struct Map {
+        // Maps IDs to indices in "values". Unless the map is paged, this
+        // is one list with room for every ID up to the greatest one ever
+        // added, which never shrinks.
         map_idx_t * id_to_index;
         size_t id_to_index_size;
 
+        // If not 0, the map is paged and "id_to_index" is unused. The
+        // indices of IDs "i" * "id_page_size" up to (but not including)
+        // ("i" + 1) * "id_page_size" are in "id_pages[i]", which is only
+        // allocated while at least one of those IDs is in the map, so
+        // memory grows with the number of IDs rather than with the
+        // greatest one.
+        size_t id_page_size;
+        // log2("id_page_size").
+        int id_page_shift;
+        map_idx_t ** id_pages;
+        // The number of IDs in each page.
+        map_idx_t * id_page_lengths;
+        size_t id_page_count;
+
         pcecs_id_t * index_to_id;
         size_t value_size;
         void * values;
@@ -34,6 +75,13 @@ struct Map {
 // "value_destructor" destroys a map value, passed as a void pointer.
 struct Map create_map(size_t value_size, void (* value_destructor)(void * value));
 
+// Same as "create_map", but the map is paged with pages of
+// "id_page_size" IDs, which must be a power of two. Finding a value
+// takes one more load than in other maps, which is worth it when the IDs
+// in the map are few or scattered compared to the greatest one.
+struct Map create_paged_map(size_t value_size, void (* value_destructor)(void * value),
+        size_t id_page_size);
+
 // Returns whether or not "map" can map "id" to anything.
 bool map_contains(const struct Map * map, pcecs_id_t id);
 
@@ -52,6 +100,11 @@ void * get_map_element(const struct Map * map, pcecs_id_t id);
 // Map "id" to "value", provided "id" isn't already in "map".
 void add_to_map(struct Map * map, pcecs_id_t id, void * value);
 
+// The memory allocated by "map" itself, not counting memory owned by
+// its values. IDs that aren't mapped to anything still take up room in
+// the list from IDs to indices, which counts as unused.
+struct PcecsMemUsage map_mem_usage(const struct Map * map);
+
 // Remove "id" and the value it maps to, and destroy the value
 // using the value destructor "map" is initialized with.
 void remove_from_map(struct Map * map, pcecs_id_t id);
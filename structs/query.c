@@ -0,0 +1,136 @@
+#include "query.h"
+#include "../globals/id_mgrs.h"
+#include "../globals/maps.h"
+#include "../tools/log.h"
+#include "arct_data.h"
+#include "ct_data.h"
+
+// Returns a query with ID "PCECS_INVALID_ID" if no query has the
+// requirements "requirements".
+static struct Query find_query(const struct CtSet * requirements)
+{
+        // Queries are only indexed by the first component type of their
+        // requirements, so that's the only place to look.
+        struct Ct ct = first_ct_in_set(requirements);
+        const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+
+        for (size_t i = 0; i < ct_data->queries.len; ++i) {
+                struct Query query;
+                query.id = ct_data->queries.contents[i];
+
+                const struct QueryData * query_data = get_map_element(&g_query_map, query.id);
+                if (ct_sets_equal(&query_data->requirements, requirements)) {
+                        return query;
+                }
+        }
+
+        return (struct Query) {
+                .id = PCECS_INVALID_ID
+        };
+}
+
+// Adds every existing archetype matching "query_data" to it.
+static void add_matching_arcts(struct QueryData * query_data)
+{
+        // Archetypes only match if they include every required component
+        // type, so only the archetypes including one specific (but
+        // arbitrary) required component type have to be tested.
+        struct Ct ct = first_ct_in_set(&query_data->requirements);
+        const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+
+        for (size_t i = 0; i < ct_data->arcts.len; ++i) {
+                pcecs_id_t arct_id = ct_data->arcts.contents[i];
+                const struct ArctData * arct_data = get_map_element(&g_arct_map, arct_id);
+
+                if (ct_set_in_set(&query_data->requirements, &arct_data->ct_set)) {
+                        add_to_id_pool(&query_data->arcts, arct_id);
+                }
+        }
+}
+
+struct Query create_query(const struct CtSet * requirements)
+{
+        ASSERT(!ct_set_empty(requirements), "Cannot create query with no requirements.");
+
+        struct Query found_query = find_query(requirements);
+        if (found_query.id != PCECS_INVALID_ID) {
+                return found_query;
+        }
+
+        LOG_DEBUG("Creating query from " CT_SET_FS " ...\n", CT_SET_FA(*requirements));
+
+        struct Query query = {
+                .id = generate_id_of_type(ID_MGR_QUERIES)
+        };
+
+        struct QueryData query_data;
+        query_data.requirements = create_ct_set();
+        copy_ct_set(&query_data.requirements, requirements);
+        query_data.arcts = create_id_pool();
+        query_data.systems = create_id_pool();
+        add_matching_arcts(&query_data);
+
+        add_to_map(&g_query_map, query.id, &query_data);
+
+        // Index the query by its first component type, which is also
+        // where "find_query" looks for it.
+        struct Ct ct = first_ct_in_set(requirements);
+        struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+        add_to_id_pool(&ct_data->queries, query.id);
+
+        LOG_DEBUG("Created " QUERY_FS ".\n", QUERY_FA(query));
+        return query;
+}
+
+void add_arct_to_queries(struct Arct arct)
+{
+        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+        // Every query is indexed by exactly one of its component types,
+        // so no query is visited twice, and any query not indexed by a
+        // component type of "arct" requires something "arct" lacks.
+        struct Ct ct = first_ct_in_set(&arct_data->ct_set);
+        while (ct.id != PCECS_INVALID_ID) {
+
+                const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+                for (size_t i = 0; i < ct_data->queries.len; ++i) {
+
+                        struct QueryData * query_data;
+                        query_data = get_map_element(&g_query_map, ct_data->queries.contents[i]);
+
+                        if (!ct_set_in_set(&query_data->requirements, &arct_data->ct_set)) {
+                                continue;
+                        }
+
+                        add_to_id_pool(&query_data->arcts, arct.id);
+                        for (size_t j = 0; j < query_data->systems.len; ++j) {
+                                add_to_id_pool(&arct_data->systems, query_data->systems.contents[j]);
+                        }
+                }
+
+                ct = next_ct_in_set(&arct_data->ct_set, ct);
+        }
+}
+
+void remove_arct_from_queries(struct Arct arct)
+{
+        const struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+        // The queries are found the same way as in "add_arct_to_queries".
+        struct Ct ct = first_ct_in_set(&arct_data->ct_set);
+        while (ct.id != PCECS_INVALID_ID) {
+
+                const struct CtData * ct_data = get_map_element(&g_ct_map, ct.id);
+                for (size_t i = 0; i < ct_data->queries.len; ++i) {
+
+                        struct QueryData * query_data;
+                        query_data = get_map_element(&g_query_map, ct_data->queries.contents[i]);
+
+                        if (ct_set_in_set(&query_data->requirements, &arct_data->ct_set)) {
+                                remove_from_id_pool(&query_data->arcts, arct.id);
+                        }
+                }
+
+                ct = next_ct_in_set(&arct_data->ct_set, ct);
+        }
+}
@@ -0,0 +1,56 @@
+// Queries cache the archetypes matching a set of required component
+// types, so that executing systems doesn't involve searching through
+// every archetype.
+// Every system has a query, but systems with the exact same
+// requirements share the same one.
+// Queries are kept up to date as archetypes are created: each query is
+// indexed by one of its component types (see "CtData"), and a new
+// archetype only has to be tested against the queries indexed by its
+// own component types.
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "../ids/id.h"
+#include "../ids/id_pool.h"
+#include "../interface/ct_set.h"
+#include "arct.h"
+
+#define QUERY_FS "query (" PCECS_ID_FS ")"
+#define QUERY_FA(query) PCECS_ID_FA((query).id)
+
+#define QUERY_DATA_FS "query data (%d archetypes, %d systems)"
+#define QUERY_DATA_FA(query_data) (int) (query_data).arcts.len, (int) (query_data).systems.len
+
+struct Query {
+        pcecs_id_t id;
+};
+
+// The underlying data of queries.
+// IDs of queries are mapped to this structure in "g_query_map".
+struct QueryData {
+        // The component types an archetype must contain to match the
+        // query.
+        struct CtSet requirements;
+        // The archetypes matching the query.
+        struct IdPool arcts;
+        // The systems whose requirements are the same as this query's.
+        // May be empty, in which case the query is still kept up to date
+        // in case a system with the same requirements is created later.
+        struct IdPool systems;
+};
+
+// Returns the query of the component types in "requirements", creating
+// it if it doesn't already exist. "requirements" cannot be empty.
+// Unlike archetypes, queries cannot be destroyed.
+struct Query create_query(const struct CtSet * requirements);
+
+// Adds "arct" to every query it matches, and adds the systems of those
+// queries to "arct". Must be called once, right after "arct" is created.
+void add_arct_to_queries(struct Arct arct);
+
+// Removes "arct" from every query it matches. Must be called right
+// before "arct" is destroyed.
+void remove_arct_from_queries(struct Arct arct);
+
+#endif
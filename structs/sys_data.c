@@ -11,16 +11,30 @@ static struct SysFuncs create_sys_funcs(void)
         };
 }
 
-struct SysData create_sys_data(const struct CtSet * requirements)
+static struct SysBatchFuncs create_sys_batch_funcs(void)
+{
+        return (struct SysBatchFuncs) {
+                .update = NULL,
+                .draw = NULL
+        };
+}
+
+struct SysData create_sys_data(const struct CtSet * reads, const struct CtSet * writes)
 {
         LOG_DEBUG("Creating system info ...\n");
 
         struct SysData sys_data;
-        // "requirements" (the argument) is deep-copied so the system
-        // doesn't unexpectedly change when that variable changes.
-        sys_data.requirements = create_ct_set();
-        copy_ct_set(&sys_data.requirements, requirements);
+        // "reads" and "writes" (the arguments) are deep-copied so the
+        // system doesn't unexpectedly change when those variables change.
+        sys_data.reads = create_ct_set();
+        copy_ct_set(&sys_data.reads, reads);
+        sys_data.writes = create_ct_set();
+        copy_ct_set(&sys_data.writes, writes);
+        sys_data.requirements = ct_set_union(reads, writes);
+        sys_data.query = create_query(&sys_data.requirements);
         sys_data.funcs = create_sys_funcs();
+        sys_data.batch_funcs = create_sys_batch_funcs();
+        sys_data.batch_rows = 0;
 
         LOG_DEBUG("Created " SYS_DATA_FS ".\n", SYS_DATA_FA(sys_data));
         return sys_data;
@@ -28,8 +42,11 @@ struct SysData create_sys_data(const struct CtSet * requirements)
 
 void destroy_sys_data(struct SysData * sys_data)
 {
-        (void) sys_data;
-        // TODO: code
+        // The query outlives the system, since queries can't be
+        // destroyed and other systems may share it.
+        destroy_ct_set(&sys_data->requirements);
+        destroy_ct_set(&sys_data->reads);
+        destroy_ct_set(&sys_data->writes);
 }
 
 void destroy_sys_data_void(void * sys_data)
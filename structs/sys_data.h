@@ -7,6 +7,7 @@
 #include "../interface/ct_set.h"
 #include "../interface/cgroup.h"
 #include "../interface/sys_funcs.h"
+#include "query.h"
 
 #define SYS_DATA_FS "system data%s"
 #define SYS_DATA_FA(sys_data) ""
@@ -20,13 +21,36 @@ struct SysFuncs {
         sys_func_t destroy;
 };
 
+// Functions affecting whole archetypes at once (see "cbatch.h").
+// Only updating and drawing happens for many entities at once, so
+// there are no batch versions of the other functions.
+struct SysBatchFuncs {
+        sys_batch_func_t update;
+        sys_batch_func_t draw;
+};
+
 struct SysData {
+        // The component types the system reads without changing them,
+        // and the ones it may change. A component type in both sets
+        // counts as written.
+        struct CtSet reads;
+        struct CtSet writes;
+        // The union of "reads" and "writes"; entities must contain all
+        // of these to be affected by the system.
         struct CtSet requirements;
+        // The query caching the archetypes matching "requirements".
+        struct Query query;
         struct SysFuncs funcs;
+        struct SysBatchFuncs batch_funcs;
+        // The maximum number of rows in a batch, or 0 if batches hold
+        // whole archetypes (see "set_sys_batch_rows").
+        size_t batch_rows;
 };
 
-// Create and initialize a "SysData" structure.
-struct SysData create_sys_data(const struct CtSet * requirements);
+// Create and initialize a "SysData" structure reading the component
+// types in "reads" and writing the ones in "writes", finding or
+// creating the query of their union on the way.
+struct SysData create_sys_data(const struct CtSet * reads, const struct CtSet * writes);
 
 // Free the resources allocated by "sys_data".
 void destroy_sys_data(struct SysData * sys_data);
@@ -0,0 +1,305 @@
+#include "sys_schedule.h"
+#include "../globals/maps.h"
+#include "../tools/log.h"
+#include "../tools/mem_tools.h"
+#include "../tools/thread_pool.h"
+#include "arct.h"
+#include "arct_data.h"
+#include "sys_data.h"
+#include "query.h"
+#include "deferred_cmds.h"
+
+#define MEM_TAG MEM_TAG_SCHEDULE
+
+#define SYS_SCHEDULE_FS "system schedule (%d systems, %d stages)"
+#define SYS_SCHEDULE_FA(schedule) (int) (schedule).sys_count, (int) (schedule).stage_count
+
+struct SysSchedule {
+        // The systems of every stage, one stage after another.
+        struct Sys * systems;
+        size_t sys_count;
+        // Stage "i" ends right before index "stage_ends[i]" of "systems".
+        size_t * stage_ends;
+        size_t stage_count;
+        // "true" if systems were created or destroyed after the schedule
+        // was built.
+        bool outdated;
+};
+
+// One system function executed on a range of rows of one archetype.
+struct SysJob {
+        sys_func_t func;
+        sys_batch_func_t batch_func;
+        struct Arct arct;
+        // The rows as seen by the system. Used to iterate through the
+        // entities as well, since the iteration of tables isn't meant
+        // to be shared between threads.
+        struct CBatch batch;
+};
+
+static struct SysSchedule g_schedule = {
+        .systems = NULL,
+        .sys_count = 0,
+        .stage_ends = NULL,
+        .stage_count = 0,
+        .outdated = true
+};
+
+static struct ThreadPool g_pool;
+static size_t g_thread_count = 1;
+static bool g_schedule_running = false;
+
+void set_sys_schedule_thread_count(size_t thread_count)
+{
+        ASSERT_OR_HANDLE(thread_count > 0, , "Cannot run systems on 0 threads.");
+        ASSERT(!g_schedule_running, "Cannot change the thread count while systems are running.");
+
+        if (g_thread_count > 1) {
+                destroy_thread_pool(&g_pool);
+        }
+
+        g_thread_count = thread_count;
+        if (g_thread_count > 1) {
+                g_pool = create_thread_pool(g_thread_count);
+        }
+        set_deferred_cmd_thread_count(g_thread_count);
+}
+
+size_t sys_schedule_thread_count(void)
+{
+        return g_thread_count;
+}
+
+void invalidate_sys_schedule(void)
+{
+        g_schedule.outdated = true;
+}
+
+bool sys_schedule_running(void)
+{
+        return g_schedule_running;
+}
+
+// Returns "true" if "sys1" and "sys2" cannot run at the same time,
+// which is when one of them writes a component type the other one
+// reads or writes. Systems only reading the same component types
+// may run at the same time, even on the same archetypes.
+static bool systems_conflict(const struct SysData * sys1, const struct SysData * sys2)
+{
+        return ct_sets_intersect(&sys1->writes, &sys2->requirements) ||
+                ct_sets_intersect(&sys2->writes, &sys1->requirements);
+}
+
+static void rebuild_sys_schedule(void)
+{
+        LOG_DEBUG("Rebuilding " SYS_SCHEDULE_FS " ...\n", SYS_SCHEDULE_FA(g_schedule));
+
+        size_t sys_count = g_sys_map.length;
+        const struct SysData * sys_datas = g_sys_map.values;
+
+        // Every system goes in the stage right after the last stage of
+        // a conflicting system before it, so conflicting systems still
+        // run in the order they're found in the system map.
+        size_t * stage_of_sys = ALLOC(size_t, sys_count);
+        size_t stage_count = 0;
+        for (size_t i = 0; i < sys_count; ++i) {
+                stage_of_sys[i] = 0;
+                for (size_t j = 0; j < i; ++j) {
+                        if (stage_of_sys[j] >= stage_of_sys[i] &&
+                            systems_conflict(&sys_datas[i], &sys_datas[j]))
+                        {
+                                stage_of_sys[i] = stage_of_sys[j] + 1;
+                        }
+                }
+                if (stage_of_sys[i] + 1 > stage_count) {
+                        stage_count = stage_of_sys[i] + 1;
+                }
+        }
+
+        REALLOC(&g_schedule.systems, struct Sys, sys_count);
+        REALLOC(&g_schedule.stage_ends, size_t, stage_count);
+
+        // Sort the systems by stage.
+        size_t sys_idx = 0;
+        for (size_t stage = 0; stage < stage_count; ++stage) {
+                for (size_t i = 0; i < sys_count; ++i) {
+                        if (stage_of_sys[i] == stage) {
+                                g_schedule.systems[sys_idx].id = g_sys_map.index_to_id[i];
+                                ++sys_idx;
+                        }
+                }
+                g_schedule.stage_ends[stage] = sys_idx;
+        }
+
+        g_schedule.sys_count = sys_count;
+        g_schedule.stage_count = stage_count;
+        g_schedule.outdated = false;
+
+        FREE(stage_of_sys);
+
+        LOG_DEBUG("Rebuilt " SYS_SCHEDULE_FS ".\n", SYS_SCHEDULE_FA(g_schedule));
+}
+
+static void run_sys_job(void * ctx, size_t job_idx, size_t thread_idx)
+{
+        const struct SysJob * job = (const struct SysJob *) ctx + job_idx;
+
+        // Structural changes go to the buffer of this thread.
+        defer_cmds_on_thread(thread_idx);
+
+        if (job->func) {
+                struct CGroup cgroup;
+                cgroup.sys = job->batch.sys;
+
+                // Backwards, like "first_entity_in_ctable" and
+                // "next_entity_in_ctable".
+                for (size_t i = job->batch.row_count; i-- > 0;) {
+                        cgroup.entity = job->batch.entities[i];
+                        job->func(cgroup);
+                }
+        }
+
+        if (job->batch_func) {
+                job->batch_func(job->batch);
+        }
+}
+
+// The number of batches "sys_data" splits "row_count" rows into.
+static size_t batch_count(const struct SysData * sys_data, size_t row_count)
+{
+        if (sys_data->batch_rows == 0) {
+                return row_count == 0 ? 0 : 1;
+        }
+        return (row_count + sys_data->batch_rows - 1) / sys_data->batch_rows;
+}
+
+// The number of batches "sys_data" splits the rows of "ctable" into.
+// Batches can't cross the end of a chunk, so the rows stored after each
+// other are split separately.
+static size_t ctable_batch_count(const struct SysData * sys_data, const struct CTable * ctable)
+{
+        size_t count = 0;
+        row_idx_t span_start = 0;
+        while (span_start < ctable->row_count) {
+                row_idx_t span_end = ctable_contiguous_end(ctable, span_start);
+                count += batch_count(sys_data, span_end - span_start);
+                span_start = span_end;
+        }
+        return count;
+}
+
+// Creates one job for every batch of every archetype of every system
+// in "stage", and stores the number of jobs in "job_count".
+// Everything the jobs need is looked up here, on the calling thread,
+// so the threads only have to run the system functions.
+static struct SysJob * create_stage_jobs(size_t stage, enum SysFuncType func_type, size_t * job_count)
+{
+        size_t stage_start = stage == 0 ? 0 : g_schedule.stage_ends[stage - 1];
+        size_t stage_end = g_schedule.stage_ends[stage];
+
+        // Count the jobs before allocating them.
+        *job_count = 0;
+        for (size_t i = stage_start; i < stage_end; ++i) {
+                const struct SysData * sys_data = get_map_element(&g_sys_map, g_schedule.systems[i].id);
+                const struct QueryData * query_data = get_map_element(&g_query_map, sys_data->query.id);
+
+                for (size_t j = 0; j < query_data->arcts.len; ++j) {
+                        const struct ArctData * arct_data;
+                        arct_data = get_map_element(&g_arct_map, query_data->arcts.contents[j]);
+                        *job_count += ctable_batch_count(sys_data, &arct_data->ctable);
+                }
+        }
+
+        struct SysJob * jobs = ALLOC(struct SysJob, *job_count);
+        size_t job_idx = 0;
+
+        for (size_t i = stage_start; i < stage_end; ++i) {
+                struct Sys sys = g_schedule.systems[i];
+                sys_func_t func = get_sys_func(sys, func_type);
+                sys_batch_func_t batch_func = get_sys_batch_func(sys, func_type);
+                if (!func && !batch_func) {
+                        continue;
+                }
+
+                const struct SysData * sys_data = get_map_element(&g_sys_map, sys.id);
+                const struct QueryData * query_data = get_map_element(&g_query_map, sys_data->query.id);
+
+                for (size_t j = 0; j < query_data->arcts.len; ++j) {
+                        struct Arct arct;
+                        arct.id = query_data->arcts.contents[j];
+
+                        struct ArctData * arct_data = get_map_element(&g_arct_map, arct.id);
+
+                        row_idx_t span_start = 0;
+                        while (span_start < arct_data->ctable.row_count) {
+                                row_idx_t span_end = ctable_contiguous_end(&arct_data->ctable, span_start);
+                                size_t row_count = span_end - span_start;
+                                size_t span_batch_count = batch_count(sys_data, row_count);
+
+                                for (size_t k = 0; k < span_batch_count; ++k) {
+                                        size_t first_row = span_start + k * row_count / span_batch_count;
+                                        size_t end_row = span_start + (k + 1) * row_count / span_batch_count;
+
+                                        // Every job reads the table, so none of
+                                        // them can reorder it under the others.
+                                        begin_ctable_read(&arct_data->ctable);
+
+                                        jobs[job_idx] = (struct SysJob) {
+                                                .func = func,
+                                                .batch_func = batch_func,
+                                                .arct = arct,
+                                                .batch = create_arct_batch(arct, sys, first_row, end_row - first_row)
+                                        };
+                                        ++job_idx;
+                                }
+                                span_start = span_end;
+                        }
+                }
+        }
+
+        *job_count = job_idx;
+        return jobs;
+}
+
+static void destroy_stage_jobs(struct SysJob * jobs, size_t job_count)
+{
+        for (size_t i = 0; i < job_count; ++i) {
+                struct ArctData * arct_data = get_map_element(&g_arct_map, jobs[i].arct.id);
+                end_ctable_read(&arct_data->ctable);
+
+                destroy_arct_batch(&jobs[i].batch);
+        }
+        FREE(jobs);
+}
+
+void exec_sys_schedule(enum SysFuncType func_type)
+{
+        ASSERT(!g_schedule_running, "Systems are already running.");
+
+        if (g_schedule.outdated) {
+                rebuild_sys_schedule();
+        }
+
+        begin_deferring_cmds();
+
+        for (size_t stage = 0; stage < g_schedule.stage_count; ++stage) {
+                size_t job_count;
+                struct SysJob * jobs = create_stage_jobs(stage, func_type, &job_count);
+
+                g_schedule_running = true;
+                if (g_thread_count > 1) {
+                        run_thread_pool_jobs(&g_pool, run_sys_job, jobs, job_count);
+                } else {
+                        for (size_t i = 0; i < job_count; ++i) {
+                                run_sys_job(jobs, i, 0);
+                        }
+                }
+                g_schedule_running = false;
+
+                destroy_stage_jobs(jobs, job_count);
+        }
+
+        // The sync point: the changes recorded by every thread are
+        // carried out once every stage is done.
+        end_deferring_cmds();
+}
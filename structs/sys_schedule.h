@@ -0,0 +1,41 @@
+// Runs systems on several threads at once.
+// Systems are split into stages where no two systems of the same stage
+// conflict, that is, neither writes components the other accesses
+// (see "create_sys_with_access").
+// Stages run one after another, and every batch (see
+// "set_sys_batch_rows") of every system in a stage is a separate job
+// for the thread pool, so all the threads join before the next stage
+// (and therefore the next frame) starts.
+
+#ifndef SYS_SCHEDULE_H
+#define SYS_SCHEDULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../interface/sys_funcs.h"
+
+// Sets the number of threads running systems in "exec_sys_schedule".
+// Cannot be called while systems are running.
+void set_sys_schedule_thread_count(size_t thread_count);
+
+// The number of threads set by "set_sys_schedule_thread_count", or 1
+// if it was never called.
+size_t sys_schedule_thread_count(void);
+
+// Marks the schedule as outdated so that it's rebuilt before systems
+// run next time. Must be called whenever a system is created or
+// destroyed.
+void invalidate_sys_schedule(void);
+
+// Executes the functions of type "func_type" of every system, running
+// systems that don't conflict on different threads.
+// Systems cannot be created or destroyed by the system functions, since
+// other threads may be reading them (see "sys_schedule_running").
+// Structural changes to entities are recorded in one command buffer per
+// thread, and applied once every stage is done (see "deferred_cmds.h").
+void exec_sys_schedule(enum SysFuncType func_type);
+
+// Returns "true" while "exec_sys_schedule" is running systems.
+bool sys_schedule_running(void);
+
+#endif
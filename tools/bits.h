@@ -0,0 +1,42 @@
+// Counting and finding the 1 bits of 64-bit words, with the instruction
+// made for it when the compiler has one (POPCNT and TZCNT/BSF on x86-64,
+// CNT and RBIT+CLZ on ARM64).
+
+#ifndef BITS_H
+#define BITS_H
+
+#include <stdint.h>
+
+#ifdef __GNUC__
+
+        // The number of 1 bits in "word".
+        #define POPCOUNT_64(word) ((int) __builtin_popcountll(word))
+        // The index of the least significant 1 bit in "word", which must
+        // not be 0.
+        #define CTZ_64(word) ((int) __builtin_ctzll(word))
+
+#else
+
+        #define POPCOUNT_64(word) x_popcount_64(word)
+        #define CTZ_64(word) x_ctz_64(word)
+
+        static inline int x_popcount_64(uint64_t word)
+        {
+                // Sums adjacent bits, then pairs, then nibbles, and finally
+                // all the bytes at once by multiplying into the top byte.
+                word -= (word >> 1) & 0x5555555555555555u;
+                word = (word & 0x3333333333333333u) + ((word >> 2) & 0x3333333333333333u);
+                word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Fu;
+                return (int) ((word * 0x0101010101010101u) >> 56);
+        }
+
+        static inline int x_ctz_64(uint64_t word)
+        {
+                // "word & -word" is only the least significant 1 bit,
+                // and subtracting 1 turns it into the 1 bits below it.
+                return x_popcount_64((word & -word) - 1);
+        }
+
+#endif
+
+#endif
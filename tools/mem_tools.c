@@ -3,92 +3,212 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "byte.h"
 #include "log.h"
+#include "mem_tools.h"
 
-#define ALLOCATIONS_CAPACITY_MULTIPLIER 2
+// The allocations are kept in a hash table keyed by their pointers, using
+// open addressing and linear probing, so that finding the allocation of a
+// pointer doesn't get slower with the number of allocations. The table
+// grows when it's more than half full and shrinks when it's less than an
+// eighth full.
+#define ALLOCATIONS_MIN_CAPACITY 64
+#define ALLOCATIONS_GROW_DIV 2
+#define ALLOCATIONS_SHRINK_DIV 8
+
+// The most distinct file names, and the most distinct type names, that
+// allocations can be made with. Must be a power of two.
+#define MAX_ALLOC_TOTALS 256
 
 #define MAX_TYPE_NAME_LENGTH 25
 #define MAX_FILE_NAME_LENGTH 20
 
-// The amount of allocations logged next to each other.
-#define ALLOCATIONS_LOGGED_PER_LINE 3
+// The maximum amount of digits assumed to be used by byte and allocation
+// counts.
+#define MAX_BYTE_COUNT_DIGIT_COUNT 12
+#define MAX_ALLOC_COUNT_DIGIT_COUNT 8
 
-// The maximum amount of digits assumed to be used by indices, lines and
-// sizes of allocations.
-#define MAX_ALLOC_IDX_DIGIT_COUNT 6
-#define MAX_LINE_DIGIT_COUNT 6
-#define MAX_ALLOCATION_SIZE_DIGITS_COUNT 6
+// The memory currently allocated in a file or of a type.
+struct AllocTotal {
+        // NULL if no allocation has been made with this total yet.
+        const char * name;
+        size_t bytes;
+        size_t count;
+};
 
 // Information about a single allocation.
 struct Allocation {
+        // NULL if the slot in the hash table is empty.
         void * ptr;
         const char * file_name;
         int line;
         const char * type_name;
         size_t type_size;
         size_t count;
+        size_t alignment;
+        enum MemTag tag;
+        // The totals "ptr" counts towards, found when it's allocated so
+        // that they don't have to be looked up again when it's freed.
+        struct AllocTotal * file_total;
+        struct AllocTotal * type_total;
 };
 
-// Global list of allocation structures.
-struct {
-        struct Allocation * contents;
+// Global hash table of allocation structures, and the totals of all of
+// them.
+static struct {
+        struct Allocation * slots;
         size_t len;
+        // Zero or a power of two.
         size_t capacity;
+        size_t bytes;
+        struct AllocTotal file_totals[MAX_ALLOC_TOTALS];
+        struct AllocTotal type_totals[MAX_ALLOC_TOTALS];
 } g_allocs;
 
-bool g_allocs_initialized = false;
+// Command buffers allocate memory on the threads running systems, so
+// the list of allocations is shared between threads.
+static pthread_mutex_t g_allocs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// A 64-bit finalizer from MurmurHash3. Allocations are aligned, so the
+// low bits of their pointers are mostly zero and can't be used as hashes
+// directly.
+static size_t hash_ptr(const void * ptr)
+{
+        uint64_t hash = (uintptr_t) ptr;
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return (size_t) hash;
+}
 
-static size_t min_valid_allocations_capacity(size_t req_capacity)
+// FNV-1a. File and type names are hashed by their contents, since the
+// same name may be a different string literal in different places.
+static size_t hash_name(const char * name)
 {
-        size_t capacity = 1;
-        while (capacity < req_capacity) {
-                capacity *= ALLOCATIONS_CAPACITY_MULTIPLIER;
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const char * c = name; *c != '\0'; ++c) {
+                hash ^= (byte_t) *c;
+                hash *= 0x100000001b3ULL;
         }
-        return capacity;
+        return (size_t) hash;
 }
 
-static void initialize_allocations(void)
+static struct AllocTotal * find_alloc_total(struct AllocTotal * totals, const char * name)
 {
-        ASSERT(!g_allocs_initialized, "Allocations already initialized.");
+        size_t mask = MAX_ALLOC_TOTALS - 1;
+        size_t idx = hash_name(name) & mask;
+        for (size_t i = 0; i < MAX_ALLOC_TOTALS; ++i) {
+                struct AllocTotal * total = &totals[(idx + i) & mask];
+                if (total->name == NULL) {
+                        total->name = name;
+                        return total;
+                }
+                if (total->name == name || strcmp(total->name, name) == 0) {
+                        return total;
+                }
+        }
 
-        g_allocs.len = 0;
-        g_allocs.capacity = min_valid_allocations_capacity(0);
-        g_allocs.contents = calloc(g_allocs.capacity, sizeof(struct Allocation));
-        g_allocs_initialized = true;
+        ASSERT(false, "Allocations made with more than %d different names.", MAX_ALLOC_TOTALS);
+        return NULL;
 }
 
-static struct Allocation * append_allocation(void)
+static struct Allocation * find_allocation(const void * ptr)
 {
-        ++g_allocs.len;
-        if (g_allocs.len > g_allocs.capacity) {
-                g_allocs.capacity = min_valid_allocations_capacity(g_allocs.len);
-                g_allocs.contents = realloc(g_allocs.contents,
-                        sizeof(struct Allocation) * g_allocs.capacity);
+        if (g_allocs.capacity == 0) {
+                return NULL;
+        }
+
+        size_t mask = g_allocs.capacity - 1;
+        for (size_t i = hash_ptr(ptr) & mask; g_allocs.slots[i].ptr != NULL; i = (i + 1) & mask) {
+                if (g_allocs.slots[i].ptr == ptr) {
+                        return &g_allocs.slots[i];
+                }
+        }
+        return NULL;
+}
+
+// Puts "allocation" in the hash table without counting it towards any
+// total. There must be an empty slot.
+static void place_allocation(struct Allocation allocation)
+{
+        size_t mask = g_allocs.capacity - 1;
+        size_t i = hash_ptr(allocation.ptr) & mask;
+        while (g_allocs.slots[i].ptr != NULL) {
+                i = (i + 1) & mask;
+        }
+        g_allocs.slots[i] = allocation;
+}
+
+static void set_allocations_capacity(size_t capacity)
+{
+        struct Allocation * old_slots = g_allocs.slots;
+        size_t old_capacity = g_allocs.capacity;
+
+        // The tracker can't track itself, so it allocates with "calloc"
+        // rather than "ALLOC".
+        g_allocs.slots = calloc(capacity, sizeof(struct Allocation));
+        ASSERT(g_allocs.slots, "Failed to allocate the allocation list.");
+        g_allocs.capacity = capacity;
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+                if (old_slots[i].ptr != NULL) {
+                        place_allocation(old_slots[i]);
+                }
+        }
+        free(old_slots);
+}
+
+static void add_allocation(struct Allocation allocation)
+{
+        if ((g_allocs.len + 1) * ALLOCATIONS_GROW_DIV > g_allocs.capacity) {
+                size_t capacity = g_allocs.capacity ? g_allocs.capacity * 2 : ALLOCATIONS_MIN_CAPACITY;
+                set_allocations_capacity(capacity);
         }
 
-        return &g_allocs.contents[g_allocs.len - 1];
+        size_t bytes = allocation.type_size * allocation.count;
+        allocation.file_total = find_alloc_total(g_allocs.file_totals, allocation.file_name);
+        allocation.type_total = find_alloc_total(g_allocs.type_totals, allocation.type_name);
+        allocation.file_total->bytes += bytes;
+        ++allocation.file_total->count;
+        allocation.type_total->bytes += bytes;
+        ++allocation.type_total->count;
+        g_allocs.bytes += bytes;
+
+        place_allocation(allocation);
+        ++g_allocs.len;
 }
 
-static void pop_allocation_index(size_t idx)
+static void remove_allocation(struct Allocation * allocation)
 {
-        // Move everything beyond "idx" one step back, so the allocation at
-        // "idx" + 1 is moved to "idx", "idx" + 2 to "idx" + 1 and so on.
-        struct Allocation * alloc_at_idx = &g_allocs.contents[idx];
-        size_t len_after_idx = g_allocs.len - (idx + 1);
-        memmove(alloc_at_idx, alloc_at_idx + 1, len_after_idx * sizeof(struct Allocation));
-
-        // Now that the last part of the list is moved one step back, the
-        // last element will have a copy in the second-last index. By
-        // decreasing the length, we keep the second copy but get rid of
-        // the initial one.
+        size_t bytes = allocation->type_size * allocation->count;
+        allocation->file_total->bytes -= bytes;
+        --allocation->file_total->count;
+        allocation->type_total->bytes -= bytes;
+        --allocation->type_total->count;
+        g_allocs.bytes -= bytes;
+
+        // Allocations after the removed one may have been placed further
+        // from their hashes than they'd have been if the removed one was
+        // never there. Those are moved back into the hole, which moves the
+        // hole forwards, until an empty slot is reached. That way, no
+        // allocation is ever separated from its hash by an empty slot.
+        size_t mask = g_allocs.capacity - 1;
+        size_t hole = allocation - g_allocs.slots;
+        for (size_t i = (hole + 1) & mask; g_allocs.slots[i].ptr != NULL; i = (i + 1) & mask) {
+                size_t home = hash_ptr(g_allocs.slots[i].ptr) & mask;
+                if (((i - home) & mask) >= ((i - hole) & mask)) {
+                        g_allocs.slots[hole] = g_allocs.slots[i];
+                        hole = i;
+                }
+        }
+        g_allocs.slots[hole].ptr = NULL;
         --g_allocs.len;
 
-        // Resize if capacity is far too large for length.
-        if (g_allocs.len * ALLOCATIONS_CAPACITY_MULTIPLIER <= g_allocs.capacity) {
-                g_allocs.capacity = min_valid_allocations_capacity(g_allocs.len);
-                g_allocs.contents = realloc(g_allocs.contents,
-                        sizeof(struct Allocation) * g_allocs.capacity);
+        if (g_allocs.len * ALLOCATIONS_SHRINK_DIV < g_allocs.capacity
+                && g_allocs.capacity > ALLOCATIONS_MIN_CAPACITY) {
+                set_allocations_capacity(g_allocs.capacity / 2);
         }
 }
 
@@ -122,13 +242,15 @@ void * x_allocate(
         int line,
         const char * type_name,
         size_t type_size,
-        size_t count)
+        size_t count,
+        size_t alignment,
+        enum MemTag tag)
 {
-        if (!g_allocs_initialized) {
-                initialize_allocations();
-        }
+        ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0,
+                "Alignment %d is not a power of two in \"%s\", line %d.",
+                (int) alignment, file_name, line);
 
-        void * allocated_memory = calloc(count, type_size);
+        void * allocated_memory = g_allocator.alloc(g_allocator.owner, type_size * count, alignment, tag);
         // When allocating 0 bytes, the result might be a NULL pointer.
         // Such pointers are not added to the allocation list, since
         // they may be generated multiple times and we'll have no idea
@@ -140,21 +262,31 @@ void * x_allocate(
         ASSERT(allocated_memory,
                 "Failed to allocate %d instances of \"%s\" in \"%s\", line %d.",
                 (int) count, type_name, file_name, line);
+        ASSERT(((uintptr_t) allocated_memory & (alignment - 1)) == 0,
+                "Allocator misaligned %d instances of \"%s\" in \"%s\", line %d.",
+                (int) count, type_name, file_name, line);
+
+        // Memory allocated in debug mode is zeroed, like it was back when
+        // it was allocated with "calloc".
+        memset(allocated_memory, 0, type_size * count);
 
-        struct Allocation * allocation = append_allocation();
-        *allocation = (struct Allocation) {
+        pthread_mutex_lock(&g_allocs_mutex);
+        add_allocation((struct Allocation) {
                 .ptr = allocated_memory,
                 .file_name = file_name_without_path(file_name),
                 .line = line,
                 .type_name = type_name,
                 .type_size = type_size,
-                .count = count
-        };
+                .count = count,
+                .alignment = alignment,
+                .tag = tag
+        });
+        pthread_mutex_unlock(&g_allocs_mutex);
 
         return allocated_memory;
 }
 
-void x_free(void * ptr, const char * file_name, int line)
+void x_free(void * ptr, size_t alignment, enum MemTag tag, const char * file_name, int line)
 {
         // Real "free" ignores NULL pointers, so we do to.
         if (ptr == NULL) {
@@ -162,18 +294,27 @@ void x_free(void * ptr, const char * file_name, int line)
         }
 
         bool allocation_found = false;
+        struct Allocation allocation;
         // Unused if assertions are disabled; this line prevents a warning.
         (void) allocation_found;
-        for (size_t i = 0; i < g_allocs.len; ++i) {
-                if (g_allocs.contents[i].ptr == ptr) {
-                        pop_allocation_index(i);
-                        allocation_found = true;
-                        break;
-                }
+        (void) allocation;
+        pthread_mutex_lock(&g_allocs_mutex);
+        struct Allocation * found_allocation = find_allocation(ptr);
+        if (found_allocation) {
+                allocation = *found_allocation;
+                remove_allocation(found_allocation);
+                allocation_found = true;
         }
+        pthread_mutex_unlock(&g_allocs_mutex);
         ASSERT(allocation_found, "%p not allocated in \"%s\", line %d.",
                 ptr, file_name, line);
-        free(ptr);
+        // The allocator may rely on getting back what it allocated with.
+        ASSERT(allocation.alignment == alignment && allocation.tag == tag,
+                "%p freed with alignment %d and tag %d in \"%s\", line %d, but allocated "
+                "with alignment %d and tag %d in \"%s\", line %d.",
+                ptr, (int) alignment, (int) tag, file_name, line, (int) allocation.alignment,
+                (int) allocation.tag, allocation.file_name, allocation.line);
+        g_allocator.free(g_allocator.owner, ptr, alignment, tag);
 }
 
 void * x_realloc(
@@ -182,57 +323,115 @@ void * x_realloc(
         int line,
         const char * type_name,
         size_t type_size,
-        size_t count)
+        size_t count,
+        enum MemTag tag)
 {
-        struct Allocation * allocation = NULL;
-        int allocation_idx = -1;
-        for (size_t i = 0; i < g_allocs.len; ++i) {
-                if (g_allocs.contents[i].ptr == ptr) {
-                        allocation = &g_allocs.contents[i];
-                        allocation_idx = i;
-                }
-        }
+        pthread_mutex_lock(&g_allocs_mutex);
+        struct Allocation * allocation = find_allocation(ptr);
 
         ASSERT(allocation || ptr == NULL, "%p not allocated in \"%s\", line %d.",
                 ptr, file_name, line);
-
-        if (allocation == NULL) {
-                allocation = append_allocation();
-                allocation_idx = g_allocs.len - 1;
+        ASSERT(allocation == NULL || (allocation->alignment == DEFAULT_ALIGNMENT && allocation->tag == tag),
+                "Cannot reallocate %p with tag %d in \"%s\", line %d, since it's allocated with "
+                "alignment %d and tag %d in \"%s\", line %d.",
+                ptr, (int) tag, file_name, line, (int) allocation->alignment, (int) allocation->tag,
+                allocation->file_name, allocation->line);
+
+        // "realloc" may move the memory, so the allocation is added again
+        // under its new pointer.
+        if (allocation) {
+                remove_allocation(allocation);
         }
 
-        void * new_ptr = realloc(ptr, type_size * count);
+        void * new_ptr = g_allocator.realloc(g_allocator.owner, ptr, type_size * count, tag);
 
         // "realloc(x, 0)" may return NULL, and in that case we don't want
         // the result in the allocation list since we would never know what
         // NULL pointer to remove (if any) when freeing NULL.
         if (new_ptr == NULL && type_size * count == 0) {
-                pop_allocation_index(allocation_idx);
+                pthread_mutex_unlock(&g_allocs_mutex);
                 return NULL;
         }
 
         ASSERT(new_ptr, "Failed to allocate %d instances of \"%s\" in \"%s\", line %d.",
                 (int) count, type_name, file_name, line);
 
-        *allocation = (struct Allocation) {
+        add_allocation((struct Allocation) {
                 .ptr = new_ptr,
                 .file_name = file_name_without_path(file_name),
                 .line = line,
                 .type_name = type_name,
                 .type_size = type_size,
-                .count = count
-        };
+                .count = count,
+                .alignment = DEFAULT_ALIGNMENT,
+                .tag = tag
+        });
+        pthread_mutex_unlock(&g_allocs_mutex);
         return new_ptr;
 }
 
+// Aligned memory is allocated with room to spare, so that an aligned
+// address can always be found within it. The address actually allocated
+// is stored right before the aligned one, so that it can be freed.
+// "aligned_alloc" would've been simpler, but it isn't available on every
+// platform.
+static void * default_alloc(void * owner, size_t size, size_t alignment, enum MemTag tag)
+{
+        (void) owner;
+        (void) tag;
+
+        if (alignment <= DEFAULT_ALIGNMENT) {
+                return malloc(size);
+        }
+
+        byte_t * allocated_memory = malloc(size + alignment - 1 + sizeof(void *));
+        if (allocated_memory == NULL) {
+                return NULL;
+        }
+
+        uintptr_t first_address = (uintptr_t) (allocated_memory + sizeof(void *));
+        uintptr_t aligned_address = (first_address + alignment - 1) & ~(uintptr_t) (alignment - 1);
+
+        void ** aligned_memory = (void **) aligned_address;
+        aligned_memory[-1] = allocated_memory;
+        return aligned_memory;
+}
+
+static void * default_realloc(void * owner, void * ptr, size_t size, enum MemTag tag)
+{
+        (void) owner;
+        (void) tag;
+        return realloc(ptr, size);
+}
+
+static void default_free(void * owner, void * ptr, size_t alignment, enum MemTag tag)
+{
+        (void) owner;
+        (void) tag;
+
+        if (alignment <= DEFAULT_ALIGNMENT || ptr == NULL) {
+                free(ptr);
+                return;
+        }
+
+        free(((void **) ptr)[-1]);
+}
+
+struct Allocator g_allocator = {
+        .alloc = default_alloc,
+        .realloc = default_realloc,
+        .free = default_free,
+        .owner = NULL
+};
+
 #ifdef ASSERTIONS
-static bool memory_overlaps(void * mem1, void * mem2, size_t mem_len)
+static bool memory_overlaps(const void * mem1, const void * mem2, size_t mem_len)
 {
-        void * mem2_first = mem2;
-        void * mem2_last = (byte_t *) mem2 + mem_len - 1;
+        const void * mem2_first = mem2;
+        const void * mem2_last = (const byte_t *) mem2 + mem_len - 1;
 
         for (size_t i = 0; i < mem_len; ++i) {
-                void * mem1_at_idx = (byte_t *) mem1 + i;
+                const void * mem1_at_idx = (const byte_t *) mem1 + i;
                 if (mem1_at_idx == mem2_first || mem1_at_idx == mem2_last) {
                         return true;
                 }
@@ -241,7 +440,7 @@ static bool memory_overlaps(void * mem1, void * mem2, size_t mem_len)
 }
 #endif
 
-void x_copy_memory(void * dest, void * src, size_t len, const char * file_name, int line)
+void x_copy_memory(void * dest, const void * src, size_t len, const char * file_name, int line)
 {
         ASSERT(!memory_overlaps(dest, src, len),
                 "Cannot copy overlapping memory in \"%s\", line %d.",
@@ -250,35 +449,35 @@ void x_copy_memory(void * dest, void * src, size_t len, const char * file_name,
         memcpy(dest, src, len);
 }
 
-void x_log_allocations(void)
+static void log_alloc_totals(const struct AllocTotal * totals, int max_name_length)
 {
-        LOG_DEBUG("Allocations (pointer, file, line, type, count):\n");
-        for (size_t i = 0; i < g_allocs.len; ++i) {
-
-                // If a full line of allocations has been logged, log a new
-                // line. Otherwise, log a "|" separating allocations.
-                if (i % ALLOCATIONS_LOGGED_PER_LINE == 0 && i > 0) {
-                        LOG_DEBUG("\n");
-                } else if (i > 0) {
-                        LOG_DEBUG(" | ");
+        // "max_name_length" unused if debug logs are compiled out; this
+        // line prevents a warning.
+        (void) max_name_length;
+
+        for (size_t i = 0; i < MAX_ALLOC_TOTALS; ++i) {
+                // Totals whose allocations are all freed aren't logged.
+                if (totals[i].name == NULL || totals[i].count == 0) {
+                        continue;
                 }
 
-                LOG_DEBUG("%*d ", MAX_ALLOC_IDX_DIGIT_COUNT, i);
-
-                LOG_DEBUG("%p ", g_allocs.contents[i].ptr);
-
-                LOG_DEBUG("%-*.*s ", MAX_FILE_NAME_LENGTH, MAX_FILE_NAME_LENGTH,
-                        g_allocs.contents[i].file_name);
-
-                LOG_DEBUG("%*d ", MAX_LINE_DIGIT_COUNT, g_allocs.contents[i].line);
-
-                LOG_DEBUG("%-*.*s ", MAX_TYPE_NAME_LENGTH, MAX_TYPE_NAME_LENGTH,
-                        g_allocs.contents[i].type_name);
-
-                LOG_DEBUG("%*d ", MAX_ALLOCATION_SIZE_DIGITS_COUNT,
-                        (int) g_allocs.contents[i].count);
+                LOG_DEBUG("%-*.*s %*d %*d\n", max_name_length, max_name_length, totals[i].name,
+                        MAX_BYTE_COUNT_DIGIT_COUNT, (int) totals[i].bytes,
+                        MAX_ALLOC_COUNT_DIGIT_COUNT, (int) totals[i].count);
         }
-        LOG_DEBUG("\n");
+}
+
+// Only the totals are logged, since there may be far too many
+// allocations to log them all.
+void x_log_allocations(void)
+{
+        pthread_mutex_lock(&g_allocs_mutex);
+        LOG_DEBUG("%d bytes in %d allocations.\n", (int) g_allocs.bytes, (int) g_allocs.len);
+        LOG_DEBUG("Allocations by file (file, bytes, count):\n");
+        log_alloc_totals(g_allocs.file_totals, MAX_FILE_NAME_LENGTH);
+        LOG_DEBUG("Allocations by type (type, bytes, count):\n");
+        log_alloc_totals(g_allocs.type_totals, MAX_TYPE_NAME_LENGTH);
+        pthread_mutex_unlock(&g_allocs_mutex);
 }
 
 bool x_is_allocated(const void * ptr)
@@ -288,19 +487,16 @@ bool x_is_allocated(const void * ptr)
                 return true;
         }
 
-        for (size_t i = 0; i < g_allocs.len; ++i) {
-                if (g_allocs.contents[i].ptr == ptr) {
-                        return true;
-                }
-        }
-        return false;
+        pthread_mutex_lock(&g_allocs_mutex);
+        bool allocated = find_allocation(ptr) != NULL;
+        pthread_mutex_unlock(&g_allocs_mutex);
+        return allocated;
 }
 
 size_t x_mem_in_use(void)
 {
-        size_t mem = 0;
-        for (size_t i = 0; i < g_allocs.len; ++i) {
-                mem += g_allocs.contents[i].type_size * g_allocs.contents[i].count;
-        }
+        pthread_mutex_lock(&g_allocs_mutex);
+        size_t mem = g_allocs.bytes;
+        pthread_mutex_unlock(&g_allocs_mutex);
         return mem;
 }
@@ -5,6 +5,12 @@
 #define MEM_TOOLS_H
 #include <string.h>
 #include "debug.h"
+#include "../interface/allocator.h"
+
+// Every allocation is made by the allocator registered with
+// "init_pcecs_with_allocator" (see "allocator.h"), and tagged with
+// "MEM_TAG", which each file allocating memory must "#define" as the
+// "enum MemTag" of the part of pcecs it belongs to.
 
 // If DEBUG_ON, use safe but slow memory functions. Otherwise, use
 // the fast but dangerous ones.
@@ -12,26 +18,40 @@
 
         // Allocate "count" instances of type "type"
         #define ALLOC(type, count) \
-                (type *) x_allocate(__FILE__, __LINE__, #type, sizeof(type), count)
+                (type *) x_allocate(__FILE__, __LINE__, #type, sizeof(type), count, \
+                        DEFAULT_ALIGNMENT, MEM_TAG)
 
         // Free "ptr". Pointer must be "ALLOC"'d or equal to "NULL".
-        #define FREE(ptr) x_free(ptr, __FILE__, __LINE__)
+        #define FREE(ptr) x_free(ptr, DEFAULT_ALIGNMENT, MEM_TAG, __FILE__, __LINE__)
 
         // Assign "ptr", assumed to be allocated using "ALLOC", to
         // "count" instances of type "type" and free its previous
         // contents. A "REALLOC"'d pointer still counts as allocated
         // with "ALLOC".
         #define REALLOC(ptr, type, count) \
-                (void) (*(ptr) = x_realloc(*(ptr), __FILE__, __LINE__, #type, sizeof(type), count))
+                (void) (*(ptr) = x_realloc(*(ptr), __FILE__, __LINE__, #type, sizeof(type), count, MEM_TAG))
+
+        // Allocate "count" instances of type "type" at an address that's
+        // a multiple of "alignment", which must be a power of two.
+        // Aligned memory can't be "REALLOC"'d, and must be freed using
+        // "FREE_ALIGNED" with the same "alignment".
+        #define ALLOC_ALIGNED(type, count, alignment) \
+                (type *) x_allocate(__FILE__, __LINE__, #type, sizeof(type), count, \
+                        valid_alignment(alignment), MEM_TAG)
+
+        // Free "ptr". Pointer must be "ALLOC_ALIGNED"'d with "alignment"
+        // or equal to "NULL".
+        #define FREE_ALIGNED(ptr, alignment) \
+                x_free(ptr, valid_alignment(alignment), MEM_TAG, __FILE__, __LINE__)
 
         // Shallowly copy "count" instances of type "type" from "src"
         // to "dest". "src" and "dest" cannot have overlapping memory.
         #define COPY_MEMORY(dest, src, type, count) \
-                x_copy_memory(dest, src, sizeof(type) * count, __FILE__, __LINE__)
+                x_copy_memory(dest, src, sizeof(type) * (count), __FILE__, __LINE__)
 
-        // Log everything that's allocated using "ALLOC" and not yet
-        // freed using "FREE".
-        #define LOG_ALLOCATIONS(log_level) x_log_allocations(log_level)
+        // Log how much is allocated using "ALLOC" and not yet freed
+        // using "FREE", in total, per file and per type.
+        #define LOG_ALLOCATIONS(log_level) x_log_allocations()
 
         // Returns "true" if "ptr" is allocated using "ALLOC".
         #define IS_ALLOCATED(ptr) x_is_allocated(ptr)
@@ -50,11 +70,19 @@
         // a costly error checking and even more costly debugging,
         // which is exactly what we want since choices without
         // risks are not interesting choices.
-        #define ALLOC(type, count) (type *) malloc(sizeof(type) * count)
-        #define FREE(ptr) free(ptr)
+        #define ALLOC(type, count) \
+                (type *) g_allocator.alloc(g_allocator.owner, sizeof(type) * (count), \
+                        DEFAULT_ALIGNMENT, MEM_TAG)
+        #define FREE(ptr) g_allocator.free(g_allocator.owner, ptr, DEFAULT_ALIGNMENT, MEM_TAG)
         #define REALLOC(ptr, type, count) \
-                (void) (*(ptr) = realloc(*(ptr), sizeof(type) * count))
-        #define COPY_MEMORY(dest, src, type, count) memcpy(dest, src, sizeof(type) * count)
+                (void) (*(ptr) = g_allocator.realloc(g_allocator.owner, *(ptr), \
+                        sizeof(type) * (count), MEM_TAG))
+        #define ALLOC_ALIGNED(type, count, alignment) \
+                (type *) g_allocator.alloc(g_allocator.owner, sizeof(type) * (count), \
+                        valid_alignment(alignment), MEM_TAG)
+        #define FREE_ALIGNED(ptr, alignment) \
+                g_allocator.free(g_allocator.owner, ptr, valid_alignment(alignment), MEM_TAG)
+        #define COPY_MEMORY(dest, src, type, count) memcpy(dest, src, sizeof(type) * (count))
         #define LOG_ALLOCATIONS(log_level)
 
 // "MEM_IN_USE" and "IS_ALLOCATED" not defined since it's only accessible
@@ -62,17 +90,30 @@
 
 #endif
 
-#define SET_MEMORY(dest, val, type, count) memset(dest, val, sizeof(type) * count)
-#define MEMORY_EQUALS(mem1, mem2, type, count) (memcmp(mem1, mem2, sizeof(type) * count) == 0)
+#define SET_MEMORY(dest, val, type, count) memset(dest, val, sizeof(type) * (count))
+#define MEMORY_EQUALS(mem1, mem2, type, count) (memcmp(mem1, mem2, sizeof(type) * (count)) == 0)
+
+// The allocator every allocation is made by. Defaults to one using
+// "malloc", "realloc" and "free".
+extern struct Allocator g_allocator;
+
+// Memory with less alignment than "DEFAULT_ALIGNMENT" is allocated with
+// "DEFAULT_ALIGNMENT" instead.
+static inline size_t valid_alignment(size_t alignment)
+{
+        return alignment > DEFAULT_ALIGNMENT ? alignment : DEFAULT_ALIGNMENT;
+}
 
 void * x_allocate(
         const char * file_name,
         int line,
         const char * type_name,
         size_t type_size,
-        size_t count);
+        size_t count,
+        size_t alignment,
+        enum MemTag tag);
 
-void x_free(void * ptr, const char * file_name, int line);
+void x_free(void * ptr, size_t alignment, enum MemTag tag, const char * file_name, int line);
 
 void * x_realloc(
         void * ptr,
@@ -80,9 +121,10 @@ void * x_realloc(
         int line,
         const char * type_name,
         size_t type_size,
-        size_t count);
+        size_t count,
+        enum MemTag tag);
 
-void x_copy_memory(void * dest, void * src, size_t len, const char * file_name, int line);
+void x_copy_memory(void * dest, const void * src, size_t len, const char * file_name, int line);
 
 void x_log_allocations(void);
 
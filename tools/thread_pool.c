@@ -0,0 +1,256 @@
+#include "thread_pool.h"
+#include <stdbool.h>
+#include "mem_tools.h"
+#include "log.h"
+#include "debug.h"
+
+#define MEM_TAG MEM_TAG_THREAD_POOL
+
+// The jobs from "begin" until "end" that are left for one thread.
+// The owner takes jobs from the beginning, while thieves take them
+// from the end.
+struct JobRange {
+        pthread_mutex_t mutex;
+        size_t begin;
+        size_t end;
+};
+
+struct ThreadPoolShared {
+        pthread_mutex_t mutex;
+        // Signalled when new jobs are available or the pool is quitting.
+        pthread_cond_t jobs_available;
+        // Signalled when a worker stops working on the current jobs.
+        pthread_cond_t workers_done;
+
+        // Incremented every time new jobs are handed out, so that
+        // workers can tell new jobs from the ones they already finished.
+        size_t generation;
+        job_func_t job_func;
+        void * ctx;
+
+        // The jobs left for every thread. Range 0 belongs to the caller
+        // of "run_thread_pool_jobs" and range "i" to worker "i" - 1.
+        struct JobRange * ranges;
+        size_t range_count;
+
+        // The number of workers currently working on jobs. New jobs are
+        // only handed out once this is 0, so that a late worker never
+        // mixes up the jobs of two generations.
+        size_t active_workers;
+        bool quitting;
+};
+
+struct ThreadPoolWorker {
+        pthread_t thread;
+        struct ThreadPoolShared * shared;
+        size_t range_idx;
+};
+
+// Takes the first job of "range", returning "false" if it's empty.
+static bool take_job(struct JobRange * range, size_t * job_idx)
+{
+        pthread_mutex_lock(&range->mutex);
+
+        bool found = range->begin < range->end;
+        if (found) {
+                *job_idx = range->begin++;
+        }
+
+        pthread_mutex_unlock(&range->mutex);
+        return found;
+}
+
+// Moves the last half (rounded up) of the jobs of another thread to
+// the empty range "range_idx", returning "false" if every other range
+// is empty too.
+static bool steal_jobs(struct ThreadPoolShared * shared, size_t range_idx)
+{
+        // Start with the next range so that thieves spread out instead
+        // of all going for range 0.
+        for (size_t i = 1; i < shared->range_count; ++i) {
+                struct JobRange * victim = &shared->ranges[(range_idx + i) % shared->range_count];
+
+                pthread_mutex_lock(&victim->mutex);
+                size_t stolen_count = (victim->end - victim->begin + 1) / 2;
+                size_t stolen_end = victim->end;
+                victim->end -= stolen_count;
+                pthread_mutex_unlock(&victim->mutex);
+
+                if (stolen_count > 0) {
+                        struct JobRange * range = &shared->ranges[range_idx];
+
+                        pthread_mutex_lock(&range->mutex);
+                        range->begin = stolen_end - stolen_count;
+                        range->end = stolen_end;
+                        pthread_mutex_unlock(&range->mutex);
+
+                        return true;
+                }
+        }
+        return false;
+}
+
+// Runs jobs of the current generation, starting with the ones in range
+// "range_idx", until every range is empty.
+// "shared->mutex" must not be locked, since the jobs run at the same
+// time on other threads.
+static void work_on_jobs(struct ThreadPoolShared * shared, size_t range_idx)
+{
+        do {
+                size_t job_idx;
+                while (take_job(&shared->ranges[range_idx], &job_idx)) {
+                        shared->job_func(shared->ctx, job_idx, range_idx);
+                }
+        } while (steal_jobs(shared, range_idx));
+}
+
+static void * worker_main(void * arg)
+{
+        struct ThreadPoolWorker * worker = arg;
+        struct ThreadPoolShared * shared = worker->shared;
+        size_t seen_generation = 0;
+
+        pthread_mutex_lock(&shared->mutex);
+        while (true) {
+                while (!shared->quitting && shared->generation == seen_generation) {
+                        pthread_cond_wait(&shared->jobs_available, &shared->mutex);
+                }
+                if (shared->quitting) {
+                        break;
+                }
+                seen_generation = shared->generation;
+
+                ++shared->active_workers;
+                pthread_mutex_unlock(&shared->mutex);
+
+                work_on_jobs(shared, worker->range_idx);
+
+                pthread_mutex_lock(&shared->mutex);
+                --shared->active_workers;
+
+                pthread_cond_broadcast(&shared->workers_done);
+        }
+        pthread_mutex_unlock(&shared->mutex);
+
+        return NULL;
+}
+
+struct ThreadPool create_thread_pool(size_t thread_count)
+{
+        LOG_DEBUG("Creating thread pool with %d threads ...\n", (int) thread_count);
+
+        ASSERT(thread_count > 0, "Thread pools need at least one thread.");
+
+        struct ThreadPool pool;
+        pool.thread_count = thread_count;
+
+        pool.shared = ALLOC(struct ThreadPoolShared, 1);
+        pthread_mutex_init(&pool.shared->mutex, NULL);
+        pthread_cond_init(&pool.shared->jobs_available, NULL);
+        pthread_cond_init(&pool.shared->workers_done, NULL);
+        pool.shared->generation = 0;
+        pool.shared->job_func = NULL;
+        pool.shared->ctx = NULL;
+        pool.shared->active_workers = 0;
+        pool.shared->quitting = false;
+
+        pool.shared->ranges = ALLOC(struct JobRange, thread_count);
+        pool.shared->range_count = thread_count;
+        for (size_t i = 0; i < thread_count; ++i) {
+                pthread_mutex_init(&pool.shared->ranges[i].mutex, NULL);
+                pool.shared->ranges[i].begin = 0;
+                pool.shared->ranges[i].end = 0;
+        }
+
+        // The caller of "run_thread_pool_jobs" is one of the threads, and
+        // owns range 0.
+        pool.workers = ALLOC(struct ThreadPoolWorker, thread_count - 1);
+        for (size_t i = 0; i < thread_count - 1; ++i) {
+                pool.workers[i].shared = pool.shared;
+                pool.workers[i].range_idx = i + 1;
+                pthread_create(&pool.workers[i].thread, NULL, worker_main, &pool.workers[i]);
+        }
+
+        LOG_DEBUG("Created " THREAD_POOL_FS ".\n", THREAD_POOL_FA(pool));
+        return pool;
+}
+
+void destroy_thread_pool(struct ThreadPool * pool)
+{
+        LOG_DEBUG("Destroying " THREAD_POOL_FS " ...\n", THREAD_POOL_FA(*pool));
+
+        pthread_mutex_lock(&pool->shared->mutex);
+        pool->shared->quitting = true;
+        pthread_cond_broadcast(&pool->shared->jobs_available);
+        pthread_mutex_unlock(&pool->shared->mutex);
+
+        for (size_t i = 0; i < pool->thread_count - 1; ++i) {
+                pthread_join(pool->workers[i].thread, NULL);
+        }
+
+        for (size_t i = 0; i < pool->shared->range_count; ++i) {
+                pthread_mutex_destroy(&pool->shared->ranges[i].mutex);
+        }
+        FREE(pool->shared->ranges);
+
+        pthread_cond_destroy(&pool->shared->workers_done);
+        pthread_cond_destroy(&pool->shared->jobs_available);
+        pthread_mutex_destroy(&pool->shared->mutex);
+
+        FREE(pool->workers);
+        FREE(pool->shared);
+}
+
+void run_thread_pool_jobs(struct ThreadPool * pool, job_func_t job_func, void * ctx, size_t job_count)
+{
+        struct ThreadPoolShared * shared = pool->shared;
+
+        // Running a single job on a worker would only add the cost of
+        // waking it up.
+        if (job_count <= 1 || pool->thread_count == 1) {
+                for (size_t i = 0; i < job_count; ++i) {
+                        job_func(ctx, i, 0);
+                }
+                return;
+        }
+
+        pthread_mutex_lock(&shared->mutex);
+
+        // Wait for workers still leaving the previous jobs.
+        while (shared->active_workers > 0) {
+                pthread_cond_wait(&shared->workers_done, &shared->mutex);
+        }
+
+        shared->job_func = job_func;
+        shared->ctx = ctx;
+
+        // Split the jobs evenly, giving the first "job_count" %
+        // "range_count" ranges one job more than the rest.
+        size_t jobs_per_range = job_count / shared->range_count;
+        size_t extra_jobs = job_count % shared->range_count;
+        size_t range_begin = 0;
+        for (size_t i = 0; i < shared->range_count; ++i) {
+                size_t range_size = jobs_per_range + (i < extra_jobs ? 1 : 0);
+
+                // No worker is active, so no other thread touches the
+                // ranges.
+                shared->ranges[i].begin = range_begin;
+                shared->ranges[i].end = range_begin + range_size;
+                range_begin += range_size;
+        }
+
+        ++shared->generation;
+        pthread_cond_broadcast(&shared->jobs_available);
+        pthread_mutex_unlock(&shared->mutex);
+
+        work_on_jobs(shared, 0);
+
+        // Every range is empty, but jobs taken by workers may still be
+        // running. A job is always finished by the worker that took it
+        // before it leaves.
+        pthread_mutex_lock(&shared->mutex);
+        while (shared->active_workers > 0) {
+                pthread_cond_wait(&shared->workers_done, &shared->mutex);
+        }
+        pthread_mutex_unlock(&shared->mutex);
+}
@@ -0,0 +1,53 @@
+// A pool of worker threads running numbered jobs.
+// The thread calling "run_thread_pool_jobs" works on the jobs too, so
+// a pool for "n" threads only starts "n" - 1 workers.
+// The jobs are split evenly between the threads up front. A thread
+// running out of jobs steals half of the remaining jobs of another
+// thread, so threads finishing early help out the slow ones without
+// every job going through one shared counter.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define THREAD_POOL_FS "thread pool (%d threads)"
+#define THREAD_POOL_FA(pool) (int) (pool).thread_count
+
+// Runs job number "job_idx", where "ctx" is the argument given to
+// "run_thread_pool_jobs". "thread_idx" is the index of the thread
+// running the job, from 0 (the caller of "run_thread_pool_jobs") until
+// the thread count of the pool, so jobs can keep per-thread data.
+typedef void (* job_func_t)(void * ctx, size_t job_idx, size_t thread_idx);
+
+// State shared between the pool and its workers. It's allocated
+// separately so that "struct ThreadPool"s can be copied around while
+// the workers keep pointing to the same state.
+struct ThreadPoolShared;
+
+// A worker thread and the index of its jobs in the shared state.
+struct ThreadPoolWorker;
+
+struct ThreadPool {
+        // The number of threads working on jobs, including the caller
+        // of "run_thread_pool_jobs".
+        size_t thread_count;
+        struct ThreadPoolWorker * workers;
+        struct ThreadPoolShared * shared;
+};
+
+// Creates a pool running jobs on "thread_count" threads (at least 1).
+struct ThreadPool create_thread_pool(size_t thread_count);
+
+// Joins and destroys the workers of "pool". Cannot be called while
+// jobs are running.
+void destroy_thread_pool(struct ThreadPool * pool);
+
+// Calls "job_func(ctx, i, thread_idx)" once for every "i" from 0 until "job_count",
+// spread over the threads of "pool" in no particular order.
+// Returns once every job is finished.
+// Cannot be called by a job, or by several threads at once.
+void run_thread_pool_jobs(struct ThreadPool * pool, job_func_t job_func, void * ctx, size_t job_count);
+
+#endif
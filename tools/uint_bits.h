@@ -0,0 +1,24 @@
+// Unsigned integer types chosen by their width in bits, for the types
+// whose width can be chosen at compile time ("pcecs_id_t",
+// "entity_gen_t", "row_idx_t" and "map_idx_t"). The width must be 8,
+// 16, 32 or 64.
+
+#ifndef UINT_BITS_H
+#define UINT_BITS_H
+
+#include <stdint.h>
+#include <inttypes.h>
+
+// The unsigned integer type of "bits" bits, e.g. "uint32_t".
+#define UINT_OF_BITS(bits) X_UINT_OF_BITS(bits)
+#define X_UINT_OF_BITS(bits) uint ## bits ## _t
+
+// The "printf" conversion of that type without the "%", e.g. "PRIu32".
+#define PRIU_OF_BITS(bits) X_PRIU_OF_BITS(bits)
+#define X_PRIU_OF_BITS(bits) PRIu ## bits
+
+// The greatest value of an unsigned integer type. The cast is outside
+// the "~", since "~" promotes types narrower than "int" to "int".
+#define MAX_OF_UINT(type) ((type) ~(type) 0)
+
+#endif